@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+#
+# markers.py - convert a logic analyzer capture of ziptest MARKERS output
+#              into a per-phase timing table
+#
+# Capture parallel port data lines D0-D7 and export the capture as CSV.
+# The first column must be the sample time in seconds.  It must be
+# followed either by eight columns with the state of D0 through D7, or
+# by a single column with the byte value (decimal or 0x hex).  Lines
+# which do not start with a number (headers, comments) are ignored.
+#
+# Marker byte encoding (see MARKERS in ziptest.c):
+#     bits 7-5  phase: 1=DATA 2=ADDR 3=CELL 4=READ
+#     bits 4-3  kind: 0=phase start (0) / end (1), 1=unit start,
+#               2=unit end, 3=step
+#     bits 2-0  unit (bank or SC mode) or low bits of the step number
+#
+# Usage: markers.py [-g glitch_seconds] capture.csv
+
+import sys
+
+PHASES = {1: "DATA", 2: "ADDR", 3: "CELL", 4: "READ"}
+SC_MODES = ["none", "burst", "page", "page+burst"]
+
+
+def parse_value(fields):
+    if len(fields) >= 9:
+        value = 0
+        for bit in range(8):
+            if int(float(fields[1 + bit])) != 0:
+                value |= 1 << bit
+        return value
+    return int(fields[1], 0)
+
+
+def read_events(path, glitch):
+    """Return (time, value) for each value held longer than glitch"""
+    events = []
+    pending = None
+    with open(path) as f:
+        for line in f:
+            fields = [x.strip() for x in line.replace(";", ",").split(",")]
+            try:
+                time = float(fields[0])
+                value = parse_value(fields)
+            except (ValueError, IndexError):
+                continue
+            if pending is not None and value == pending[1]:
+                continue
+            if pending is not None and time - pending[0] >= glitch:
+                if not events or events[-1][1] != pending[1]:
+                    events.append(pending)
+            pending = (time, value)
+    if pending is not None and (not events or events[-1][1] != pending[1]):
+        events.append(pending)
+    return events
+
+
+def unit_name(phase, unit):
+    if phase == 4:
+        return "mode %s" % SC_MODES[unit & 3]
+    return "bank %u" % unit
+
+
+def decode(events):
+    phase_start = {}
+    unit_start = {}
+    steps = {}
+    rows = []
+    for time, value in events:
+        phase = value >> 5
+        kind = (value >> 3) & 3
+        arg = value & 7
+        if phase not in PHASES:
+            continue
+        if kind == 0 and arg == 0:
+            phase_start[phase] = time
+        elif kind == 0 and arg == 1 and phase in phase_start:
+            rows.append((phase_start.pop(phase), PHASES[phase], None, time,
+                         0))
+        elif kind == 1:
+            unit_start[(phase, arg)] = time
+            steps[(phase, arg)] = 0
+        elif kind == 2 and (phase, arg) in unit_start:
+            start = unit_start.pop((phase, arg))
+            rows.append((start, PHASES[phase], unit_name(phase, arg), time,
+                         steps.pop((phase, arg), 0)))
+        elif kind == 3:
+            for key in steps:
+                if key[0] == phase:
+                    steps[key] += 1
+    return sorted(rows, key=lambda row: (row[0], row[2] is not None))
+
+
+def main(argv):
+    glitch = 100e-9
+    args = argv[1:]
+    if len(args) >= 2 and args[0] == "-g":
+        glitch = float(args[1])
+        args = args[2:]
+    if len(args) != 1:
+        sys.stderr.write("usage: %s [-g glitch_seconds] capture.csv\n" %
+                         argv[0])
+        return 1
+
+    rows = decode(read_events(args[0], glitch))
+    if not rows:
+        print("No markers found")
+        return 1
+    origin = rows[0][0]
+    print("Phase  Unit            Start ms   Time ms  Steps  Step usec")
+    print("------ ------------- ---------- --------- ------ ----------")
+    for start, phase, unit, end, count in rows:
+        msec = (end - start) * 1000
+        line = "%-6s %-13s %10.3f %9.3f" % (phase, unit or "",
+                                            (start - origin) * 1000, msec)
+        if count:
+            line += " %6u %10.2f" % (count, msec * 1000 / count)
+        print(line)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
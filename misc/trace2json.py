@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+#
+# trace2json.py - convert a ziptest TRACE= file to Chrome trace JSON
+#
+# The output may be loaded in chrome://tracing or https://ui.perfetto.dev
+# Test phases are shown on one track, work in each ZIP bank on its own
+# track, and Ramsey control register writes as instant events.
+#
+# Trace file format (see TRACE= in ziptest.c):
+#     ZIPTEST TRACE 1
+#     FREQ <EClock ticks per second>
+#     DROPPED <records lost when the ring wrapped>
+#     E <event> <bank> <time> <addr> <arg>    (time, addr, arg in hex)
+# Window events have the start time, and their length in ticks as arg.
+#
+# Usage: trace2json.py ziptest.trace > ziptest.json
+
+import json
+import sys
+
+MAGIC = "ZIPTEST TRACE 1"
+PHASES = ["DATA", "ADDR", "CELL", "BURST", "ILEAVE", "RANGE"]
+ZIP_BANKS = 4
+
+# event: (name, is_window)
+EVENTS = {
+    1: ("phase", True),
+    2: ("data lines", True),
+    3: ("address lines", True),
+    4: ("cell bank", True),
+    5: ("cell block", True),
+    6: ("ramsey", False),
+}
+
+TID_PHASE = 0
+TID_OTHER = ZIP_BANKS + 1
+
+
+def read_trace(path):
+    """Return (freq, dropped, records) from a trace file"""
+    freq = 709379
+    dropped = 0
+    records = []
+    with open(path) as f:
+        if f.readline().strip() != MAGIC:
+            raise ValueError("%s is not a ziptest trace file" % path)
+        for line in f:
+            fields = line.split()
+            if len(fields) == 2 and fields[0] == "FREQ":
+                freq = int(fields[1])
+            elif len(fields) == 2 and fields[0] == "DROPPED":
+                dropped = int(fields[1])
+            elif len(fields) == 6 and fields[0] == "E":
+                records.append((int(fields[1]), int(fields[2]),
+                                int(fields[3], 16), int(fields[4], 16),
+                                int(fields[5], 16)))
+    return freq, dropped, records
+
+
+def unwrap(records):
+    """Extend the 32-bit EClock times so that they do not wrap.  Window
+       records are written at the end of the window, so their start time
+       may be earlier than the time of the record before."""
+    result = []
+    base = 0
+    last = None
+    for event, bank, time, addr, arg in records:
+        time += base
+        if last is not None and time < last - 0x80000000:
+            base += 0x100000000
+            time += 0x100000000
+        elif last is not None and time > last + 0x80000000:
+            time -= 0x100000000
+        last = max(last, time) if last is not None else time
+        result.append((event, bank, time, addr, arg))
+    return result
+
+
+def convert(freq, records):
+    usec = 1000000.0 / freq
+    origin = min(rec[2] for rec in records)
+    events = []
+    for tid, name in [(TID_PHASE, "phases"), (TID_OTHER, "other")] + \
+            [(bank + 1, "bank %u" % bank) for bank in range(ZIP_BANKS)]:
+        events.append({"name": "thread_name", "ph": "M", "pid": 0,
+                       "tid": tid, "args": {"name": name}})
+    for event, bank, time, addr, arg in records:
+        name, is_window = EVENTS.get(event, ("event %u" % event, False))
+        entry = {"name": name, "pid": 0,
+                 "ts": (time - origin) * usec,
+                 "args": {"addr": "0x%08x" % addr, "arg": "0x%x" % arg}}
+        if event == 1:
+            entry["name"] = PHASES[addr] if addr < len(PHASES) else name
+            entry["tid"] = TID_PHASE
+        elif bank < ZIP_BANKS:
+            entry["tid"] = bank + 1
+        else:
+            entry["tid"] = TID_OTHER
+        if is_window:
+            entry["ph"] = "X"
+            entry["dur"] = arg * usec
+            entry["args"]["ticks"] = arg
+        else:
+            entry["ph"] = "i"
+            entry["s"] = "p"
+        events.append(entry)
+    return events
+
+
+def main(argv):
+    if len(argv) != 2:
+        sys.stderr.write("usage: %s ziptest.trace > ziptest.json\n" % argv[0])
+        return 1
+    try:
+        freq, dropped, records = read_trace(argv[1])
+    except (IOError, ValueError) as err:
+        sys.stderr.write("%s\n" % err)
+        return 1
+    if not records:
+        sys.stderr.write("No trace records found\n")
+        return 1
+    if dropped:
+        sys.stderr.write("%u older records were dropped by ziptest\n" %
+                         dropped)
+    json.dump({"traceEvents": convert(freq, unwrap(records)),
+               "displayTimeUnit": "ns"}, sys.stdout)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -1,24 +1,39 @@
         SECTION text,code
         DS.l 0
 
+        XDEF    _bench_move16
+        XDEF    _bench_rmw
+        XDEF    _bench_write
+        XDEF    _block_checksum
         XDEF    _burst_copy
         XDEF    _burst_copyline
         XDEF    _burst_read_moveml
         XDEF    _burst_read_readl
         XDEF    _burst_test_read
+        XDEF    _cell_trigger
         XDEF    _mmu_get_tc_030
         XDEF    _mmu_set_tc_030
         XDEF    _mmu_get_tc_040
         XDEF    _mmu_set_tc_040
         XDEF    _cpu_dcache_flush
+        XDEF    _cpu_dcache_flush_030
+        XDEF    _cpu_dcache_flush_040
+        XDEF    _cpu_dcache_flush_range
+        XDEF    _cpu_dcache_flush_range_040
         XDEF    _get_sr
+        XDEF    _hot_kernels_start
+        XDEF    _hot_kernels_end
+        XDEF    _interleave_check
         XDEF    _irq_disable
         XDEF    _irq_enable
+        XDEF    _latency_chase
         XREF    _SysBase
 
 RAMSEY_CONTROL  EQU     $00de0003
 SysBase         EQU     $00000004
 AttnFlags       EQU     $0128
+CIAB_PRA        EQU     $00bfd000   ; Parallel port BUSY, POUT, SEL
+PPORT_DATA      EQU     $00bfe101   ; Parallel port data lines
 
 AFB_68020       EQU     1
 AFB_68030       EQU     2
@@ -67,6 +82,13 @@ wait2:
         movem.l (sp)+,a2/d2-d6
         rts
 
+;
+; Functions between _hot_kernels_start and _hot_kernels_end are copied
+; to fast memory by the cell test, so they must be position independent
+; and may only branch within this range.
+;
+_hot_kernels_start:
+
 ;
 ; void burst_copyline(APTR *dst, APTR *src);
 ;     $4(sp) is dst
@@ -107,6 +129,73 @@ bcopy_check:
         move.l a1,d0
         rts
 
+; uint32_t block_checksum(APTR *src, uint len);
+;     $4(sp) is src
+;     $8(sp) is len (multiple of 32 bytes)
+;     Fletcher-style checksum of 32-bit words.  d1 is the sum of words
+;     and d2 is the sum of d1 after each word, which makes the result
+;     sensitive to word order.  Reads use movem.l like burst_copy.
+_block_checksum:
+        move.l $4(sp),a0
+        move.l $8(sp),d0
+        movem.l a2-a5/d2-d7,-(sp)
+        moveq  #0,d1
+        moveq  #0,d2
+        lsr.l #5,d0                 ; 32 bytes per iteration
+        bra bsum_check
+bsum_loop:
+        movem.l (a0)+,a2-a5/d4-d7   ; d4-d7 are loaded before a2-a5
+        add.l  d4,d1
+        add.l  d1,d2
+        add.l  d5,d1
+        add.l  d1,d2
+        add.l  d6,d1
+        add.l  d1,d2
+        add.l  d7,d1
+        add.l  d1,d2
+        add.l  a2,d1
+        add.l  d1,d2
+        add.l  a3,d1
+        add.l  d1,d2
+        add.l  a4,d1
+        add.l  d1,d2
+        add.l  a5,d1
+        add.l  d1,d2
+bsum_check:
+        dbf   d0,bsum_loop          ; DICE Das equivalent of dbra
+        swap   d2
+        eor.l  d2,d1
+        move.l d1,d0
+        movem.l (sp)+,a2-a5/d2-d7
+        rts
+_hot_kernels_end:
+
+;
+; void cell_trigger(void);
+;     Called by the generated verify kernels (jsr (a1)) when a mismatch
+;     is found, with the mismatching bits in d1.  The parallel port SEL
+;     line is raised immediately as a trigger.  Then a map of failing
+;     nibbles (bit n set if nibble n failed) is driven on the data lines
+;     and SEL is lowered.  All registers are preserved.
+_cell_trigger:
+        bset   #2,CIAB_PRA          ; SEL high: trigger
+        movem.l d1-d4,-(sp)
+        moveq  #0,d2                ; d2 = nibble map
+        moveq  #7,d3
+trig_loop:
+        rol.l  #4,d1                ; Next nibble, from 7 down to 0
+        add.b  d2,d2
+        moveq  #$f,d4
+        and.b  d1,d4
+        beq.s  trig_next
+        addq.b #1,d2
+trig_next:
+        dbf    d3,trig_loop
+        move.b d2,PPORT_DATA
+        movem.l (sp)+,d1-d4
+        bclr   #2,CIAB_PRA          ; SEL low: data lines valid
+        rts
+
 ; void burst_read_moveml(APTR *dst, uint len);
 ;     $4(sp) is dst
 ;     $8(sp) is len
@@ -164,6 +253,276 @@ breadrl_check:
         movem.l (sp)+,a2-a5/d4-d7
         rts
 
+; void bench_write(APTR *dst, uint len);
+;     $4(sp) is dst
+;     $8(sp) is len (multiple of 64, less than 4MB)
+_bench_write:
+        move.l $4(sp),a0
+        move.l $8(sp),d0
+        move.l #$a55a5aa5,d1
+        lsr.l #6,d0                 ; 64 bytes per iteration
+        bra bwrite_check
+bwrite_loop:
+        move.l d1,(a0)+
+        move.l d1,(a0)+
+        move.l d1,(a0)+
+        move.l d1,(a0)+
+        move.l d1,(a0)+
+        move.l d1,(a0)+
+        move.l d1,(a0)+
+        move.l d1,(a0)+
+        move.l d1,(a0)+
+        move.l d1,(a0)+
+        move.l d1,(a0)+
+        move.l d1,(a0)+
+        move.l d1,(a0)+
+        move.l d1,(a0)+
+        move.l d1,(a0)+
+        move.l d1,(a0)+
+bwrite_check:
+        dbf   d0,bwrite_loop
+        rts
+
+; void bench_rmw(APTR *dst, uint len);
+;     Read-modify-write (invert) every long
+;     $4(sp) is dst
+;     $8(sp) is len (multiple of 64, less than 4MB)
+_bench_rmw:
+        move.l $4(sp),a0
+        move.l $8(sp),d0
+        lsr.l #6,d0                 ; 64 bytes per iteration
+        bra brmw_check
+brmw_loop:
+        not.l (a0)+
+        not.l (a0)+
+        not.l (a0)+
+        not.l (a0)+
+        not.l (a0)+
+        not.l (a0)+
+        not.l (a0)+
+        not.l (a0)+
+        not.l (a0)+
+        not.l (a0)+
+        not.l (a0)+
+        not.l (a0)+
+        not.l (a0)+
+        not.l (a0)+
+        not.l (a0)+
+        not.l (a0)+
+brmw_check:
+        dbf   d0,brmw_loop
+        rts
+
+; void bench_move16(APTR *dst, APTR *src, uint len);
+;     68040 and 68060 only.  Both addresses must be 16-byte aligned.
+;     $4(sp) is dst
+;     $8(sp) is src
+;     $c(sp) is len (multiple of 64, less than 4MB)
+_bench_move16:
+        move.l $4(sp),a1
+        move.l $8(sp),a0
+        move.l $c(sp),d0
+        lsr.l #6,d0                 ; 64 bytes per iteration
+        bra bmove16_check
+bmove16_loop:
+        dc.w  $f620,$9000           ; move16 (a0)+,(a1)+
+        dc.w  $f620,$9000           ; move16 (a0)+,(a1)+
+        dc.w  $f620,$9000           ; move16 (a0)+,(a1)+
+        dc.w  $f620,$9000           ; move16 (a0)+,(a1)+
+bmove16_check:
+        dbf   d0,bmove16_loop
+        rts
+
+; uint32_t latency_chase(APTR base, uint32_t offset, uint count,
+;                        uint32_t mask);
+;     Follow a chain of offsets from base, where each long holds the
+;     offset of the next long to read.  Every load depends on the previous
+;     one.  Each offset read is masked, so a stale or corrupt value still
+;     leads to a long-aligned read within base to base + mask.
+;     $4(sp) is base of the chain region
+;     $8(sp) is offset of the first long
+;     $c(sp) is count of loads (multiple of 16, less than 1M)
+;     $10(sp) is offset mask
+;     Returns the offset which would be read next.
+_latency_chase:
+        move.l d2,-(sp)
+        move.l $8(sp),a0
+        move.l $c(sp),d1
+        move.l $10(sp),d0
+        move.l $14(sp),d2
+        lsr.l #4,d0                 ; 16 loads per iteration
+        bra lchase_check
+lchase_loop:
+        move.l 0(a0,d1.l),d1
+        and.l d2,d1
+        move.l 0(a0,d1.l),d1
+        and.l d2,d1
+        move.l 0(a0,d1.l),d1
+        and.l d2,d1
+        move.l 0(a0,d1.l),d1
+        and.l d2,d1
+        move.l 0(a0,d1.l),d1
+        and.l d2,d1
+        move.l 0(a0,d1.l),d1
+        and.l d2,d1
+        move.l 0(a0,d1.l),d1
+        and.l d2,d1
+        move.l 0(a0,d1.l),d1
+        and.l d2,d1
+        move.l 0(a0,d1.l),d1
+        and.l d2,d1
+        move.l 0(a0,d1.l),d1
+        and.l d2,d1
+        move.l 0(a0,d1.l),d1
+        and.l d2,d1
+        move.l 0(a0,d1.l),d1
+        and.l d2,d1
+        move.l 0(a0,d1.l),d1
+        and.l d2,d1
+        move.l 0(a0,d1.l),d1
+        and.l d2,d1
+        move.l 0(a0,d1.l),d1
+        and.l d2,d1
+        move.l 0(a0,d1.l),d1
+        and.l d2,d1
+lchase_check:
+        dbf   d0,lchase_loop
+        move.l d1,d0
+        move.l (sp)+,d2
+        rts
+
+; void interleave_check(APTR *blocks, uint32_t seed, uint len,
+;                       uint32_t *biterr);
+;     Pattern test where every consecutive memory access goes to a
+;     different bank.  blocks[] holds the same block offset in row A of
+;     banks 0-3 followed by row B of banks 0-3.  Each long position is
+;     written in all eight blocks, in the order A0 A1 A2 A3 B0 B1 B2 B3,
+;     before moving on to the next, and then verified in the same order.
+;     Only registers are used between the accesses.  The value starts at
+;     seed and is rotated left one bit at each position.  Banks 1 and 3
+;     get its complement.  B3 is reached through an index from B2, as
+;     there are not eight free address registers.
+;     $4(sp) is blocks
+;     $8(sp) is seed
+;     $c(sp) is len of each block (multiple of 8, less than 512K)
+;     $10(sp) is biterr: failing bits of bank n are ORed into biterr[n]
+_interleave_check:
+        movem.l a2-a6/d2-d7,-(sp)
+        move.l $30(sp),a6
+        move.l $1c(a6),d6
+        sub.l  $18(a6),d6           ; d6 = B3 - B2
+        movem.l (a6),a0-a5          ; A0-A3, B0, B1
+        move.l $18(a6),a6           ; B2
+        move.l $34(sp),d0           ; d0 = seed
+        move.l $38(sp),d7
+        lsr.l #3,d7                 ; 2 longs per block per iteration
+        bra ileave_wcheck
+ileave_wloop:
+        move.l d0,d2
+        not.l  d2
+        move.l d0,(a0)+             ; A0
+        move.l d2,(a1)+             ; A1
+        move.l d0,(a2)+             ; A2
+        move.l d2,(a3)+             ; A3
+        move.l d0,(a4)+             ; B0
+        move.l d2,(a5)+             ; B1
+        move.l d0,(a6)+             ; B2
+        move.l d2,-4(a6,d6.l)       ; B3
+        rol.l  #1,d0
+        move.l d0,d2
+        not.l  d2
+        move.l d0,(a0)+             ; A0
+        move.l d2,(a1)+             ; A1
+        move.l d0,(a2)+             ; A2
+        move.l d2,(a3)+             ; A3
+        move.l d0,(a4)+             ; B0
+        move.l d2,(a5)+             ; B1
+        move.l d0,(a6)+             ; B2
+        move.l d2,-4(a6,d6.l)       ; B3
+        rol.l  #1,d0
+ileave_wcheck:
+        dbf   d7,ileave_wloop
+
+        move.l $30(sp),a6
+        movem.l (a6),a0-a5          ; A0-A3, B0, B1
+        move.l $18(a6),a6           ; B2
+        move.l $34(sp),d0           ; d0 = seed
+        move.l $38(sp),d7
+        lsr.l #3,d7                 ; 2 longs per block per iteration
+        moveq  #0,d2                ; d2-d5 = failing bits of banks 0-3
+        moveq  #0,d3
+        moveq  #0,d4
+        moveq  #0,d5
+        bra ileave_vcheck
+ileave_vloop:
+        move.l (a0)+,d1             ; A0
+        eor.l  d0,d1
+        or.l   d1,d2
+        move.l (a1)+,d1             ; A1
+        not.l  d1
+        eor.l  d0,d1
+        or.l   d1,d3
+        move.l (a2)+,d1             ; A2
+        eor.l  d0,d1
+        or.l   d1,d4
+        move.l (a3)+,d1             ; A3
+        not.l  d1
+        eor.l  d0,d1
+        or.l   d1,d5
+        move.l (a4)+,d1             ; B0
+        eor.l  d0,d1
+        or.l   d1,d2
+        move.l (a5)+,d1             ; B1
+        not.l  d1
+        eor.l  d0,d1
+        or.l   d1,d3
+        move.l (a6)+,d1             ; B2
+        eor.l  d0,d1
+        or.l   d1,d4
+        move.l -4(a6,d6.l),d1       ; B3
+        not.l  d1
+        eor.l  d0,d1
+        or.l   d1,d5
+        rol.l  #1,d0
+        move.l (a0)+,d1             ; A0
+        eor.l  d0,d1
+        or.l   d1,d2
+        move.l (a1)+,d1             ; A1
+        not.l  d1
+        eor.l  d0,d1
+        or.l   d1,d3
+        move.l (a2)+,d1             ; A2
+        eor.l  d0,d1
+        or.l   d1,d4
+        move.l (a3)+,d1             ; A3
+        not.l  d1
+        eor.l  d0,d1
+        or.l   d1,d5
+        move.l (a4)+,d1             ; B0
+        eor.l  d0,d1
+        or.l   d1,d2
+        move.l (a5)+,d1             ; B1
+        not.l  d1
+        eor.l  d0,d1
+        or.l   d1,d3
+        move.l (a6)+,d1             ; B2
+        eor.l  d0,d1
+        or.l   d1,d4
+        move.l -4(a6,d6.l),d1       ; B3
+        not.l  d1
+        eor.l  d0,d1
+        or.l   d1,d5
+        rol.l  #1,d0
+ileave_vcheck:
+        dbf   d7,ileave_vloop
+        move.l $3c(sp),a0
+        or.l   d2,(a0)+
+        or.l   d3,(a0)+
+        or.l   d4,(a0)+
+        or.l   d5,(a0)
+        movem.l (sp)+,a2-a6/d2-d7
+        rts
+
 
 ; uint32_t mmu_get_tc_030(void);
 ;     This function only works on the 68030.
@@ -198,10 +557,11 @@ _mmu_set_tc_040:
 
 ;
 ; void cpu_dcache_flush(void);
-;
+;     The _030 and _040 entry points may be called directly when the
+;     CPU type is known.
 _cpu_dcache_flush:
         move.l  SysBase,a0
-        move.l  AttnFlags(a0),d0
+        move.w  AttnFlags(a0),d0
         btst    #AFB_68040,d0
         bne.s   _cpu_dcache_flush_040
 _cpu_dcache_flush_030:
@@ -214,6 +574,47 @@ _cpu_dcache_flush_060:
         dc.w    $f478           ; cpusha (data cache)
         rts
 
+;
+; void cpu_dcache_flush_range(APTR *addr, uint len);
+;     $4(sp) is addr
+;     $8(sp) is len
+;     Push and invalidate only the data cache lines of the specified range.
+;     On 68040 and 68060, whole 4K pages are done with cpushp, and the
+;     remainder with cpushl.  The 68030 data cache is only 256 bytes, so
+;     the whole cache is cleared.
+_cpu_dcache_flush_range:
+        move.l  SysBase,a0
+        move.w  AttnFlags(a0),d0
+        btst    #AFB_68040,d0
+        beq.s   _cpu_dcache_flush_030
+_cpu_dcache_flush_range_040:
+        move.l  $4(sp),a0
+        move.l  $8(sp),d1
+        add.l   a0,d1           ; d1 = end address
+        move.l  a0,d0
+        and.w   #$0fff,d0
+        bne.s   flush_lines     ; Not page aligned
+flush_pages:
+        move.l  d1,d0
+        sub.l   a0,d0
+        cmp.l   #4096,d0
+        blt.s   flush_lines
+        dc.w    $f470           ; cpushp dc,(a0)
+        add.l   #4096,a0
+        bra.s   flush_pages
+flush_lines:
+        move.l  a0,d0
+        and.b   #$f0,d0         ; Start of line
+        move.l  d0,a0
+flush_line_loop:
+        cmpa.l  d1,a0
+        bcc.s   flush_done
+        dc.w    $f468           ; cpushl dc,(a0)
+        add.l   #16,a0
+        bra.s   flush_line_loop
+flush_done:
+        rts
+
 _irq_disable:
         move.w  sr,d0
         or.w    #$0700,sr
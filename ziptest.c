@@ -17,6 +17,7 @@
  * OR MISUSE OF THIS UTILITY OR INFORMATION REPORTED BY THIS UTILITY.
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <exec/execbase.h>
 #include <exec/memory.h>
@@ -199,6 +200,13 @@ extern struct ExecBase *SysBase;
 #define AGNUS_DMACON_R        0x00dff002  /* Agnus DMA control register (R) */
 #define AGNUS_DMACON_W        0x00dff096  /* Agnus DMA control register (W) */
 
+#define AGNUS_DMACON_SET      (1 << 15)   /* 1=Set bits, 0=Clear bits */
+#define AGNUS_DMACON_BPLEN    (1 << 8)    /* Bitplane DMA enable */
+#define AGNUS_DMACON_COPEN    (1 << 7)    /* Copper DMA enable */
+#define AGNUS_DMACON_SPREN    (1 << 5)    /* Sprite DMA enable */
+#define AGNUS_DMACON_QUIET    (AGNUS_DMACON_BPLEN | AGNUS_DMACON_COPEN | \
+                               AGNUS_DMACON_SPREN)
+
 #define RAMSEY_CONTROL_PAGE     (1 << 0)  /* 1=Page mode enabled */
 #define RAMSEY_CONTROL_BURST    (1 << 1)  /* 1=Burst mode enabled */
 #define RAMSEY_CONTROL_WRAP     (1 << 2)  /* 1=wrap, 0=no backward bursts */
@@ -211,12 +219,20 @@ extern struct ExecBase *SysBase;
 
 #define AMIGA_PPORT_DIR       0x00bfe301  /* Amiga parallel port dir register */
 #define AMIGA_PPORT_DATA      0x00bfe101  /* Amiga parallel port data reg. */
+#define AMIGA_CIAB_PRA        0x00bfd000  /* Parallel port BUSY, POUT, SEL */
+#define AMIGA_CIAB_DDRA       0x00bfd200  /* CIAB port A direction register */
+#define AMIGA_PPORT_SEL       BIT(2)      /* SEL line in AMIGA_CIAB_PRA */
 
 #define FLAG_DEBUG            0x01        /* Debug output */
 #define FLAG_MORE_DEBUG       0x02        /* More debug output */
 #define FLAG_LONG_TEST        0x04        /* Perform more thorough tests */
 #define FLAG_SHOW_DIP         0x08        /* Show DIP RAM positions */
 #define FLAG_SHOW_MAP         0x10        /* Show data bus bits (don't test) */
+#define FLAG_SUMMARY          0x20        /* Don't show per-test results */
+#define FLAG_QUIET_DMA        0x40        /* Disable display DMA in tests */
+#define FLAG_CACHE_ON         0x80        /* Cell test with data cache on */
+#define FLAG_FAIL_FAST        0x100       /* Stop at the first failure */
+#define FLAG_TRIGGER          0x200       /* Pulse parallel port on failure */
 
 #define POS_LEFT              0           /* ZIP IC in the left column */
 #define POS_RIGHT             1           /* ZIP IC in the right column */
@@ -262,23 +278,27 @@ extern struct ExecBase *SysBase;
             CacheControl(oldcachestate, CACRF_EnableD | CACRF_DBE); \
         }
 
-/* MMU_DISABLE() and MMU_RESTORE() must be called from Supervisor state */
+/*
+ * MMU_DISABLE() and MMU_RESTORE() must be called from Supervisor state.
+ * The CPU-specific functions are selected by cpu_ops_init().
+ */
 #define MMU_DISABLE() \
         { \
-            uint32_t oldmmustate; \
-            if (cpu_type == 68030) { \
-                oldmmustate = mmu_get_tc_030(); \
-                mmu_set_tc_030(oldmmustate & ~BIT(31)); \
-            } else if ((cpu_type == 68040) || (cpu_type == 68060)) { \
-                oldmmustate = mmu_get_tc_040(); \
-                mmu_set_tc_040(oldmmustate & ~BIT(15)); \
-            }
+            uint32_t oldmmustate = cpu.mmu_get_tc(); \
+            cpu.mmu_set_tc(oldmmustate & ~cpu.mmu_enable)
 #define MMU_RESTORE() \
-            if (cpu_type == 68030) { \
-                mmu_set_tc_030(oldmmustate); \
-            } else if ((cpu_type == 68040) || (cpu_type == 68060)) { \
-                mmu_set_tc_040(oldmmustate); \
-            } \
+            cpu.mmu_set_tc(oldmmustate); \
+        }
+
+/*
+ * RAMSEY_CONTROL_SET() must be called from Supervisor state.  Unlike
+ * set_ramsey_control(), it may be used inside a critical section.
+ */
+#define RAMSEY_CONTROL_SET(x) \
+        { \
+            *ADDR8(RAMSEY_CONTROL) = (x); \
+            while (*ADDR8(RAMSEY_CONTROL) != (x)) \
+                ; \
         }
 
 /* Modern stdint types */
@@ -290,12 +310,30 @@ typedef unsigned int   uint32_t;
 typedef unsigned int   uint;
 #endif
 
+static void trace_ramsey(uint control);  /* Used by set_ramsey_control() */
+static uint addr_to_bank(uint32_t addr);  /* Used by results_load() */
+
 void cpu_dcache_flush(void);
+void cpu_dcache_flush_030(void);
+void cpu_dcache_flush_040(void);
+void cpu_dcache_flush_range(volatile void *addr, uint len);
+void cpu_dcache_flush_range_040(volatile void *addr, uint len);
 void burst_copyline(volatile void *dst, volatile void *src);
 uint burst_copy(volatile void *dst, volatile void *src, uint len);
+uint32_t block_checksum(volatile void *src, uint len);
+void hot_kernels_start(void);
+void hot_kernels_end(void);
 void burst_read_moveml(volatile void *src, uint size); // must not exceed 8MB
 void burst_read_readl(volatile void *src, uint size);  // must not exceed 2MB
 void burst_test_read(volatile void *dst, volatile void *src, uint flags);
+void bench_write(volatile void *dst, uint size);
+void bench_rmw(volatile void *dst, uint size);
+void bench_move16(volatile void *dst, volatile void *src, uint size);
+uint32_t latency_chase(volatile void *base, uint32_t offset, uint count,
+                       uint32_t mask);
+void interleave_check(volatile uint32_t **blocks, uint32_t seed, uint size,
+                      uint32_t *biterr);
+void cell_trigger(void);
 uint32_t mmu_get_type(void);
 uint32_t mmu_get_tc_030(void);
 uint32_t mmu_get_tc_040(void);
@@ -305,12 +343,30 @@ uint16_t get_sr(void);
 uint16_t irq_disable(void);
 uint16_t irq_enable(void);
 static uint cpu_type = 0;
+
+/*
+ * CPU-specific primitives, selected once at startup by cpu_ops_init(),
+ * so that the test loops do not need to check the CPU type.
+ */
+static struct {
+    uint32_t (*mmu_get_tc)(void);
+    void     (*mmu_set_tc)(uint32_t tc);
+    uint32_t   mmu_enable;        /* TC register MMU enable bit */
+    void     (*dcache_flush)(void);
+    void     (*dcache_flush_range)(volatile void *addr, uint len);
+    uint8_t    sc_probe_control;  /* Ramsey bits added to Burst for probe */
+    uint       icache_budget;     /* Bytes of I-cache for generated loops */
+} cpu;
+
 static uint8_t cpu_can_do_burst = 0;
 static uint8_t mmu_is_active = 0;
 static uint8_t ramsey_version = 0;
 static uint8_t ramsey_rev = 0;
 
-static int get_mem_types(uint addrbits, uint32_t *bank_results, uint flags);
+static int get_mem_types(uint addrbits, uint32_t *bank_results,
+                         uint skip_banks, uint flags);
+static const char *mem_type_name(uint32_t *bank_results, uint bank,
+                                 uint nibble);
 
 typedef struct {
     const char skt[6];    /* String description of socket, e.g. "U881" */
@@ -436,6 +492,514 @@ static const struct {
 };
 
 
+/*
+ * Per-socket failures from the current run of the tests, indexed by
+ * [bank][nibble].  Each entry has bits for failed IO1-IO4 data lines
+ * and SOCKET_FAIL_ADDR for an address line failure.
+ */
+#define SOCKET_FAIL_IO(x)     BIT(x)
+#define SOCKET_FAIL_ADDR      BIT(4)
+static uint8_t socket_fails[ZIP_BANKS][8];
+
+/*
+ * socket_fails_record() - record failing data bits read from the specified
+ *                         bank against the ZIP sockets which provide them
+ */
+static void
+socket_fails_record(uint bank, uint32_t biterr)
+{
+    uint pos;
+    uint io_pin;
+
+    for (pos = 0; pos < ARRAY_SIZE(zip_u_data); pos++) {
+        if (zip_u_data[pos].bank != bank)
+            continue;
+        for (io_pin = 0; io_pin < 4; io_pin++) {
+            if (biterr & BIT(zip_u_data[pos].pins[io_pin])) {
+                socket_fails[bank][zip_u_data[pos].nibble] |=
+                                                    SOCKET_FAIL_IO(io_pin);
+            }
+        }
+    }
+}
+
+/*
+ * Cumulative per-socket statistics across LOOP= or TIME= iterations.
+ * The fails count is the number of iterations in which the socket had
+ * any failure.  bit_fails[] counts iterations with a failure of each of
+ * the IO1-IO4 data lines and the address lines.
+ */
+static struct {
+    uint32_t fails;
+    uint32_t bit_fails[5];
+} socket_stats[ZIP_BANKS][8];
+
+/*
+ * socket_stats_update() - accumulate failures from the current iteration
+ *                         into socket_stats[] and display a one line
+ *                         summary of the iteration
+ */
+static void
+socket_stats_update(uint loop, uint32_t elapsed, int errs)
+{
+    uint pos;
+    uint bit;
+    uint col;
+
+    col = printf("Loop %u (%u:%02u:%02u): %s", loop, elapsed / 3600,
+                 (elapsed / 60) % 60, elapsed % 60, errs ? "FAIL" : "PASS");
+    for (pos = 0; pos < ARRAY_SIZE(zip_u_data); pos++) {
+        uint    bank   = zip_u_data[pos].bank;
+        uint    nibble = zip_u_data[pos].nibble;
+        uint8_t fails  = socket_fails[bank][nibble];
+
+        if (fails == 0)
+            continue;
+        socket_stats[bank][nibble].fails++;
+        for (bit = 0; bit < ARRAY_SIZE(socket_stats[0][0].bit_fails); bit++)
+            if (fails & BIT(bit))
+                socket_stats[bank][nibble].bit_fails[bit]++;
+
+        if (col > 70) {
+            printf("\n   ");
+            col = 3;
+        }
+        col += printf(" %s", zip_u_data[pos].skt);
+    }
+    printf("\n");
+}
+
+/*
+ * socket_stats_show() - display cumulative per-socket statistics for all
+ *                       sockets which failed in at least one iteration
+ */
+static void
+socket_stats_show(uint loops)
+{
+    uint pos;
+    uint bit;
+    uint shown = 0;
+
+    printf("\nResults after %u loop%s\n", loops, (loops == 1) ? "" : "s");
+    for (pos = 0; pos < ARRAY_SIZE(zip_u_data); pos++) {
+        uint bank   = zip_u_data[pos].bank;
+        uint nibble = zip_u_data[pos].nibble;
+
+        if (socket_stats[bank][nibble].fails == 0)
+            continue;
+        if (shown++ == 0) {
+            printf("  Socket    Pass  Fail   IO1   IO2   IO3   IO4  Addr\n"
+                   "  -------- ----- ----- ----- ----- ----- ----- -----\n");
+        }
+        printf("  %s %u.%u %5u %5u", zip_u_data[pos].skt, bank, nibble,
+               loops - socket_stats[bank][nibble].fails,
+               socket_stats[bank][nibble].fails);
+        for (bit = 0; bit < ARRAY_SIZE(socket_stats[0][0].bit_fails); bit++)
+            printf(" %5u", socket_stats[bank][nibble].bit_fails[bit]);
+        printf("\n");
+    }
+    if (shown == 0)
+        printf("  All sockets passed\n");
+}
+
+/*
+ * Test phases, as recorded in a RESULTS= file
+ */
+#define PHASE_DATA    0
+#define PHASE_ADDR    1
+#define PHASE_CELL    2
+#define PHASE_BURST   3
+#define PHASE_ILEAVE  4
+#define PHASE_RANGE   5
+#define PHASE_COUNT   6
+static const char * const phase_names[PHASE_COUNT] = {
+    "DATA", "ADDR", "CELL", "BURST", "ILEAVE", "RANGE"
+};
+
+#define RESULTS_MAGIC       "ZIPTEST RESULTS 1"
+#define RESULTS_MAX_BLOCKS  64       /* Failing blocks kept per run */
+#define RESULTS_REGION_MASK 0x1ffff  /* Retest region around a failure */
+
+/*
+ * Results of this run, which are saved with RESULTS= or RETEST=, and
+ * the results loaded from a previous run with RETEST=.  Failing blocks
+ * are kept by address.  When RETEST= is active, the cell tests only test
+ * the 128K regions which contained failing blocks, plus the first block
+ * of every other 128K region as a quick sanity pass.  A bank with failing
+ * sockets but no failing blocks (found by the data or address line test,
+ * or ILEAVE) is tested in full, as is every bank with failing sockets if
+ * more than RESULTS_MAX_BLOCKS failing blocks were found.  Phases which
+ * passed are run without LONG.
+ */
+static struct {
+    uint32_t phase_errs[PHASE_COUNT];
+    uint32_t blocks[RESULTS_MAX_BLOCKS];
+    uint     block_count;
+    uint     block_overflow;  /* Failing blocks not kept */
+    uint8_t  sockets[ZIP_BANKS][8];
+} results, retest;
+static uint8_t retest_active = 0;
+static uint8_t retest_banks  = 0;  /* Banks to cell test in full */
+
+/*
+ * results_block_record() - record a failing block address for RESULTS=
+ */
+static void
+results_block_record(uint32_t addr)
+{
+    uint blk;
+
+    addr &= ~(TESTBLOCK_SIZE - 1);
+    for (blk = 0; blk < results.block_count; blk++)
+        if (results.blocks[blk] == addr)
+            return;
+    if (results.block_count < RESULTS_MAX_BLOCKS)
+        results.blocks[results.block_count++] = addr;
+    else
+        results.block_overflow++;
+}
+
+/*
+ * retest_block_wanted() - return non-zero if the specified block should
+ *                         be tested.  All blocks are tested unless RETEST=
+ *                         is active.
+ */
+static int
+retest_block_wanted(uint32_t addr)
+{
+    uint blk;
+    uint bank;
+
+    if (!retest_active || ((addr & RESULTS_REGION_MASK) == 0))
+        return (1);
+    bank = addr_to_bank(addr);
+    if ((bank < ZIP_BANKS) && (retest_banks & BIT(bank)))
+        return (1);
+    for (blk = 0; blk < retest.block_count; blk++)
+        if (((retest.blocks[blk] ^ addr) & ~RESULTS_REGION_MASK) == 0)
+            return (1);
+    return (0);
+}
+
+/*
+ * retest_flags() - return the test flags for the specified phase.  With
+ *                  RETEST=, a phase which passed last time is run without
+ *                  LONG as a quick sanity pass.
+ */
+static uint
+retest_flags(uint phase, uint flags)
+{
+    if (retest_active && (retest.phase_errs[phase] == 0))
+        flags &= ~FLAG_LONG_TEST;
+    return (flags);
+}
+
+/*
+ * results_save() - write phase results, per-socket verdicts, and failing
+ *                  blocks of this run to the specified file
+ */
+static int
+results_save(const char *filename)
+{
+    FILE *fp = fopen(filename, "w");
+    uint  pos;
+    uint  phase;
+    uint  blk;
+
+    if (fp == NULL) {
+        printf("Cannot write results to %s\n", filename);
+        return (1);
+    }
+    fprintf(fp, "%s\n", RESULTS_MAGIC);
+    for (phase = 0; phase < PHASE_COUNT; phase++) {
+        fprintf(fp, "PHASE %s %u\n", phase_names[phase],
+                results.phase_errs[phase]);
+    }
+    for (pos = 0; pos < ARRAY_SIZE(zip_u_data); pos++) {
+        uint bank   = zip_u_data[pos].bank;
+        uint nibble = zip_u_data[pos].nibble;
+
+        fprintf(fp, "SOCKET %u %u %02x %s %s\n", bank, nibble,
+                results.sockets[bank][nibble], zip_u_data[pos].skt,
+                results.sockets[bank][nibble] ? "Fail" : "Good");
+    }
+    for (blk = 0; blk < results.block_count; blk++)
+        fprintf(fp, "BLOCK %08x\n", results.blocks[blk]);
+    if (results.block_overflow != 0)
+        fprintf(fp, "OVERFLOW %u\n", results.block_overflow);
+    fclose(fp);
+    return (0);
+}
+
+/*
+ * results_load() - read the results of a previous run for RETEST=, and
+ *                  display the phases and sockets which failed
+ */
+static int
+results_load(const char *filename)
+{
+    FILE *fp = fopen(filename, "r");
+    char  line[80];
+    char  name[16];
+    uint  phase;
+    uint  pos;
+    uint  bank;
+    uint  nibble;
+    uint  fails;
+    uint  blk;
+    uint32_t value;
+
+    if (fp == NULL) {
+        printf("Cannot read results from %s\n", filename);
+        return (1);
+    }
+    if ((fgets(line, sizeof (line), fp) == NULL) ||
+        (strncmp(line, RESULTS_MAGIC, strlen(RESULTS_MAGIC)) != 0)) {
+        printf("%s is not a ziptest results file\n", filename);
+        fclose(fp);
+        return (1);
+    }
+    memset(&retest, 0, sizeof (retest));
+    while (fgets(line, sizeof (line), fp) != NULL) {
+        if (sscanf(line, "PHASE %15s %u", name, &value) == 2) {
+            for (phase = 0; phase < PHASE_COUNT; phase++)
+                if (strcmp(name, phase_names[phase]) == 0)
+                    retest.phase_errs[phase] = value;
+        } else if (sscanf(line, "SOCKET %u %u %x", &bank, &nibble,
+                          &fails) == 3) {
+            if ((bank < ZIP_BANKS) && (nibble < 8))
+                retest.sockets[bank][nibble] = fails;
+        } else if (sscanf(line, "BLOCK %x", &value) == 1) {
+            if (retest.block_count < RESULTS_MAX_BLOCKS)
+                retest.blocks[retest.block_count++] = value;
+            else
+                retest.block_overflow++;
+        } else if (sscanf(line, "OVERFLOW %u", &value) == 1) {
+            retest.block_overflow += value;
+        }
+    }
+    fclose(fp);
+    retest_active = 1;
+
+    /*
+     * Banks which failed without a failing block are tested in full, as
+     * are all failing banks if some failing blocks were not recorded.
+     */
+    retest_banks = 0;
+    for (bank = 0; bank < ZIP_BANKS; bank++)
+        for (nibble = 0; nibble < 8; nibble++)
+            if (retest.sockets[bank][nibble])
+                retest_banks |= BIT(bank);
+    for (blk = 0; (blk < retest.block_count) && !retest.block_overflow;
+         blk++) {
+        bank = addr_to_bank(retest.blocks[blk]);
+        if (bank < ZIP_BANKS)
+            retest_banks &= ~BIT(bank);
+    }
+
+    printf("Retest of failures from %s:", filename);
+    for (phase = 0; phase < PHASE_COUNT; phase++)
+        if (retest.phase_errs[phase] != 0)
+            printf(" %s", phase_names[phase]);
+    for (pos = 0; pos < ARRAY_SIZE(zip_u_data); pos++)
+        if (retest.sockets[zip_u_data[pos].bank][zip_u_data[pos].nibble])
+            printf(" %s", zip_u_data[pos].skt);
+    printf(" (%u block%s%s)\n", retest.block_count,
+           (retest.block_count == 1) ? "" : "s",
+           retest.block_overflow ? ", more not recorded" : "");
+    for (bank = 0; bank < ZIP_BANKS; bank++)
+        if (retest_banks & BIT(bank))
+            printf("  Bank %u will be cell tested in full\n", bank);
+    return (0);
+}
+
+/*
+ * results_update() - add the errors from one test phase and the socket
+ *                    failures so far to the results of this run
+ */
+static void
+results_update(uint phase, int errs)
+{
+    uint bank;
+    uint nibble;
+
+    results.phase_errs[phase] += errs;
+    for (bank = 0; bank < ZIP_BANKS; bank++)
+        for (nibble = 0; nibble < 8; nibble++)
+            results.sockets[bank][nibble] |= socket_fails[bank][nibble];
+}
+
+#define HISTORY_FILE        "ENVARC:ziptest.history"
+#define HISTORY_MAGIC       "ZIPTEST HISTORY 1"
+#define HISTORY_MAX_REGIONS 16
+
+/*
+ * Failure history kept across runs with HISTORY.  The number of runs in
+ * which each socket failed, and the 128K regions which held failing
+ * blocks in the most recent failing run, are used to order the cell test
+ * so that recurring faults are found first.
+ */
+static struct {
+    uint32_t runs;
+    uint32_t sockets[ZIP_BANKS][8];
+    uint32_t regions[HISTORY_MAX_REGIONS];
+    uint     region_count;
+} history;
+
+/*
+ * history_load() - read the failure history, if there is one, and show
+ *                  the sockets which have failed before
+ */
+static void
+history_load(void)
+{
+    FILE    *fp = fopen(HISTORY_FILE, "r");
+    char     line[80];
+    uint     pos;
+    uint     bank;
+    uint     nibble;
+    uint     shown = 0;
+    uint32_t value;
+
+    memset(&history, 0, sizeof (history));
+    if (fp == NULL)
+        return;
+    if ((fgets(line, sizeof (line), fp) == NULL) ||
+        (strncmp(line, HISTORY_MAGIC, strlen(HISTORY_MAGIC)) != 0)) {
+        fclose(fp);
+        return;
+    }
+    while (fgets(line, sizeof (line), fp) != NULL) {
+        if (sscanf(line, "RUNS %u", &value) == 1) {
+            history.runs = value;
+        } else if (sscanf(line, "SOCKET %u %u %u", &bank, &nibble,
+                          &value) == 3) {
+            if ((bank < ZIP_BANKS) && (nibble < 8))
+                history.sockets[bank][nibble] = value;
+        } else if (sscanf(line, "REGION %x", &value) == 1) {
+            if (history.region_count < HISTORY_MAX_REGIONS)
+                history.regions[history.region_count++] = value;
+        }
+    }
+    fclose(fp);
+
+    for (pos = 0; pos < ARRAY_SIZE(zip_u_data); pos++) {
+        bank   = zip_u_data[pos].bank;
+        nibble = zip_u_data[pos].nibble;
+        if (history.sockets[bank][nibble] == 0)
+            continue;
+        if (shown++ == 0)
+            printf("History of %u runs:", history.runs);
+        printf(" %s (%u)", zip_u_data[pos].skt, history.sockets[bank][nibble]);
+    }
+    if (shown != 0)
+        printf("\n");
+}
+
+/*
+ * history_save() - add the results of this run to the failure history
+ */
+static void
+history_save(void)
+{
+    FILE *fp;
+    uint  bank;
+    uint  nibble;
+    uint  blk;
+    uint  reg;
+
+    history.runs++;
+    for (bank = 0; bank < ZIP_BANKS; bank++)
+        for (nibble = 0; nibble < 8; nibble++)
+            if (results.sockets[bank][nibble] != 0)
+                history.sockets[bank][nibble]++;
+
+    /* Keep the failing regions of the most recent run which had any */
+    if (results.block_count != 0)
+        history.region_count = 0;
+    for (blk = 0; blk < results.block_count; blk++) {
+        uint32_t region = results.blocks[blk] & ~RESULTS_REGION_MASK;
+
+        for (reg = 0; reg < history.region_count; reg++)
+            if (history.regions[reg] == region)
+                break;
+        if ((reg == history.region_count) &&
+            (history.region_count < HISTORY_MAX_REGIONS)) {
+            history.regions[history.region_count++] = region;
+        }
+    }
+
+    fp = fopen(HISTORY_FILE, "w");
+    if (fp == NULL) {
+        printf("Cannot write history to %s\n", HISTORY_FILE);
+        return;
+    }
+    fprintf(fp, "%s\nRUNS %u\n", HISTORY_MAGIC, history.runs);
+    for (bank = 0; bank < ZIP_BANKS; bank++)
+        for (nibble = 0; nibble < 8; nibble++)
+            if (history.sockets[bank][nibble] != 0) {
+                fprintf(fp, "SOCKET %u %u %u\n", bank, nibble,
+                        history.sockets[bank][nibble]);
+            }
+    for (reg = 0; reg < history.region_count; reg++)
+        fprintf(fp, "REGION %08x\n", history.regions[reg]);
+    fclose(fp);
+}
+
+/*
+ * history_bank_order() - order the banks for the cell test, most
+ *                        suspicious first.  A bank's score is the number
+ *                        of socket failures and failing regions in its
+ *                        history.  Banks with equal score stay in order.
+ */
+static void
+history_bank_order(uint32_t bank_size, uint order[ZIP_BANKS])
+{
+    uint32_t score[ZIP_BANKS];
+    uint     bank;
+    uint     nibble;
+    uint     reg;
+    uint     pos;
+
+    for (bank = 0; bank < ZIP_BANKS; bank++) {
+        score[bank] = 0;
+        for (nibble = 0; nibble < 8; nibble++)
+            score[bank] += history.sockets[bank][nibble];
+    }
+    for (reg = 0; reg < history.region_count; reg++) {
+        uint32_t region = history.regions[reg];
+        if ((region < FASTMEM_TOP - bank_size * ZIP_BANKS) ||
+            (region >= FASTMEM_TOP)) {
+            continue;
+        }
+        score[(FASTMEM_TOP - 1 - region) / bank_size]++;
+    }
+
+    /* Insertion sort, which is stable */
+    for (bank = 0; bank < ZIP_BANKS; bank++) {
+        for (pos = bank; pos > 0; pos--) {
+            if (score[order[pos - 1]] >= score[bank])
+                break;
+            order[pos] = order[pos - 1];
+        }
+        order[pos] = bank;
+    }
+}
+
+/*
+ * elapsed_seconds() - return seconds elapsed since the specified DateStamp
+ */
+static uint32_t
+elapsed_seconds(struct DateStamp *start)
+{
+    struct DateStamp now;
+
+    DateStamp(&now);
+    return ((((now.ds_Days - start->ds_Days) * 24 * 60 +
+              now.ds_Minute - start->ds_Minute) * 60 * TICKS_PER_SECOND +
+             now.ds_Tick - start->ds_Tick) / TICKS_PER_SECOND);
+}
+
 /*
  * print_binary() - display binary representation of value
  */
@@ -468,6 +1032,21 @@ strcasecmp(const char *str1, const char *str2)
 }
 #endif
 
+/*
+ * arg_value() - if the argument begins with the specified keyword, which
+ *               includes the trailing '=', return a pointer to the value
+ *               which follows.  Otherwise return NULL.  The keyword must
+ *               be uppercase, and is matched regardless of case.
+ */
+static const char *
+arg_value(const char *arg, const char *keyword)
+{
+    for (; *keyword != '\0'; arg++, keyword++)
+        if ((*arg | 0x20) != (*keyword | 0x20))
+            return (NULL);
+    return (arg);
+}
+
 
 /*
  * amask_to_address() - convert a mask of RAS + CAS bits to an Amiga CPU
@@ -651,17 +1230,38 @@ usage(void)
            "an Amiga 3000 motherboard.  Options:\n"
            "    ADDR   - perform address line test\n"
            "    ASCII  - show ASCII ART of chip positions and pins\n"
+           "    BENCH[=n] - memory benchmark matrix as CSV (n repeats)\n"
+           "    BURST  - perform cell test with Ramsey Page+Burst (SC RAM)\n"
+           "    CACHEON - perform cell test with the data cache enabled\n"
            "    CELL   - perform memory cell test (verify every bit)\n"
            "    DATA   - perform data line test\n"
            "    DIP    - show DIP RAM positions\n"
            "    DEBUG  - enable debug output\n"
            "    INFO   - only show system information\n"
+           "    ILEAVE - perform bank-interleaved precharge stress test\n"
+           "    FAILFAST - stop testing at the first failure\n"
            "    FORCE  - ignore fact enforcer is present\n"
+           "    HISTORY - test previously failing areas first\n"
+           "    LATENCY - measure page hit, page miss, bank switch latency\n"
            "    LONG   - perform more thorough (slower) line test\n"
+           "    LOOP=n - repeat selected tests n times, then show totals\n"
            "    MAP    - just show map of corresponding bits (no test)\n"
+           "    MARKERS - write phase markers to the parallel port\n"
            "    QUIET  - do not display banner\n"
+           "    QUIETDMA - blank display during cell tests (faster)\n"
+           "    RANGE=start,end[,...] - cell test hex address ranges\n"
+           "    RECAL  - measure CPU burst and Ramsey clock (ignore cache)\n"
+           "    RESULTS=file - save socket verdicts and failures to file\n"
+           "    RETEST=file - retest only what failed in results file\n"
            "    SPROBE - probe for static-column memory (68030 only)\n"
-           "    STROBE - generate power-of-two address strobes for a probe\n");
+           "    STROBE - generate power-of-two address strobes for a probe\n"
+           "    STROBE=file - run script of RAS/CAS accesses for a probe\n"
+           "    TIME=s - repeat selected tests for s seconds (or Ctrl-C)\n"
+           "    TIMING - show time and throughput of each test phase\n"
+           "    TRACE=file - save trace of test events to file\n"
+           "    TRIGGER - pulse parallel port SEL on cell test failure\n"
+           "    TUNE   - find fastest stable Ramsey configuration\n"
+           "    WATCH=socket - continuously check one socket (reseating)\n");
 }
 
 /*
@@ -774,6 +1374,7 @@ set_ramsey_control(uint32_t control)
         }
     }
     SUPERVISOR_STATE_EXIT();
+    trace_ramsey(control);
 
     if (timeout == 0) {
         printf("Ramsey timeout %02x != expected %02x\n", got, control);
@@ -858,60 +1459,540 @@ get_cpu(void)
 }
 
 /*
- * test_value() writes a value to memory and reads it back, returning the
- *              result.  In order to avert bus capacitance causing false
- *              "good" values, a disturb value to different memory is
- *              emitted before the written value is read back from memory.
+ * MARKERS
+ * -------
+ * Phase markers are written to the parallel port data lines so that the
+ * phases of a run can be timed externally with a logic analyzer.  Each
+ * marker byte is encoded as:
+ *     bits 7-5  phase (MARKER_DATA, MARKER_ADDR, MARKER_CELL, MARKER_READ)
+ *     bits 4-3  kind (MARK_PHASE, MARK_UNIT_START, MARK_UNIT_END, MARK_STEP)
+ *     bits 2-0  for MARK_PHASE, MARK_PHASE_START or MARK_PHASE_END;
+ *               otherwise the unit (bank or SC mode) or low step bits
+ * misc/markers.py converts an analyzer CSV export to a timing table.
  */
-static uint32_t
-test_value(uint32_t addr, uint32_t value)
-{
-    uint32_t orig_zip;
-    uint32_t flip_zip;
-    uint32_t flip_addr;
-    uint32_t result;
+#define MARKER_DATA      1  /* data_line_test() */
+#define MARKER_ADDR      2  /* address_line_test() */
+#define MARKER_CELL      3  /* cell_data_test() */
+#define MARKER_READ      4  /* memory_read_usec() */
 
-    flip_addr = addr ^ 0x0400000;  // Choose another fastmem bank
+#define MARK_PHASE       0  /* Start or end of phase */
+#define MARK_UNIT_START  1  /* Start of bank (or SC mode) */
+#define MARK_UNIT_END    2  /* End of bank (or SC mode) */
+#define MARK_STEP        3  /* Start of a block or address bit step */
 
-    orig_zip           = *ADDR32(addr);
-    flip_zip           = *ADDR32(flip_addr);
-    *ADDR32(addr)      = value;
-    CACHE_LINE_FLUSH(ADDR32(addr), 16);
-    *ADDR32(flip_addr) = ~value;
-    CACHE_LINE_FLUSH(ADDR32(flip_addr), 16);
-    result             = *ADDR32(addr);
-    *ADDR32(addr)      = orig_zip;
-    *ADDR32(flip_addr) = flip_zip;
+#define MARK_PHASE_START 0
+#define MARK_PHASE_END   1
 
-    return (result);
-}
+static uint8_t markers_enabled = 0;
+
+static uint8_t markers_old_dir;
 
 /*
- * Perform a simple data line test on the memory by walking through a set
- * of patterns designed to expose bad components or solder joints.
- * Address lines are left at 0 for this test, so if they are stuck high
- * or stuck low it should not matter.  If they are floating, then bad data
- * lines might be reported here.
+ * markers_open() - make the parallel port data lines outputs
  */
-static uint32_t
-test_dbits(uint32_t addr, uint bitvals, uint32_t *bits_and, uint32_t *bits_or,
-           uint flags)
+static void
+markers_open(void)
 {
-    uint32_t result_and  = 0xffffffff;
-    uint32_t result_or   = 0;
-    uint32_t result_diff = 0;
-    uint32_t result;
-    uint32_t test_seq[6];
-    uint     pos;
-    uint     count;
-    uint     passes = (flags & FLAG_LONG_TEST) ? 2048 : 512;
+    markers_old_dir = *ADDR8(AMIGA_PPORT_DIR);
+    *ADDR8(AMIGA_PPORT_DATA) = 0x00;
+    *ADDR8(AMIGA_PPORT_DIR)  = 0xff;
+}
 
-    /* Push out previous output */
-    fflush(stdout);
+/*
+ * markers_close() - restore the parallel port data line direction
+ */
+static void
+markers_close(void)
+{
+    *ADDR8(AMIGA_PPORT_DATA) = 0x00;
+    *ADDR8(AMIGA_PPORT_DIR)  = markers_old_dir;
+}
 
-    test_seq[0] = 0x00000000;  /* Test stuck high */
-    test_seq[1] = 0xffffffff;  /* Test stuck low */
-    test_seq[2] = bitvals;     /* Test only interesting bits high (floating) */
+/*
+ * marker() - with MARKERS, write a phase marker to the parallel port
+ */
+static void
+marker(uint phase, uint kind, uint value)
+{
+    if (markers_enabled)
+        *ADDR8(AMIGA_PPORT_DATA) = (phase << 5) | (kind << 3) | (value & 7);
+}
+
+/*
+ * EClock timing
+ * -------------
+ * An etimer_t times one interval at a time: etimer_start(), then any
+ * number of etimer_lap() calls, then etimer_stop(), which adds the
+ * interval to a 64-bit total so that long runs do not wrap.  The cost of
+ * the ReadEClock() calls themselves is measured once by etimer_init()
+ * and subtracted from every interval.
+ *
+ * Interrupts are required by ReadEClock() to count wraps of the CIA
+ * timer it reads.  The tests use these with interrupts disabled, so each
+ * interrupt-disabled window must be shorter than one CIA timer period
+ * (ETIMER_IRQOFF_MAX ticks, about 92 ms).  A longer window is timed short
+ * by a whole period.  The windows timed here are far shorter: a cell
+ * test block or a data line test pass.
+ * timing_report() warns of any window which came close to the limit.
+ */
+#define ETIMER_IRQOFF_MAX 0x10000
+typedef struct {
+    uint32_t hi;
+    uint32_t lo;
+} acc64_t;
+
+typedef struct {
+    struct EClockVal start;
+    acc64_t          total;  /* Sum of stopped intervals, in ticks */
+} etimer_t;
+
+static uint32_t etimer_freq     = 709379;  /* EClock ticks per second */
+static uint32_t etimer_overhead = 0;       /* Ticks of start + stop alone */
+
+/*
+ * acc64_add() - add to a 64-bit accumulator
+ */
+static void
+acc64_add(acc64_t *acc, uint32_t value)
+{
+    uint32_t lo = acc->lo + value;
+
+    if (lo < acc->lo)
+        acc->hi++;
+    acc->lo = lo;
+}
+
+/*
+ * acc64_div() - divide a 64-bit accumulator by a divisor less than 65536.
+ *               The quotient must fit in 32 bits.
+ */
+static uint32_t
+acc64_div(const acc64_t *acc, uint32_t divisor)
+{
+    uint32_t digits[4];
+    uint32_t quotient = 0;
+    uint32_t rem      = 0;
+    uint     pos;
+
+    digits[0] = acc->hi >> 16;
+    digits[1] = acc->hi & 0xffff;
+    digits[2] = acc->lo >> 16;
+    digits[3] = acc->lo & 0xffff;
+    for (pos = 0; pos < 4; pos++) {
+        uint32_t cur = (rem << 16) | digits[pos];
+
+        quotient = (quotient << 16) | (cur / divisor);
+        rem      = cur % divisor;
+    }
+    return (quotient);
+}
+
+/*
+ * etimer_init() - get the EClock frequency and measure timer overhead
+ */
+static void
+etimer_init(void)
+{
+    struct EClockVal eclk_start;
+    struct EClockVal eclk_end;
+    uint   pass;
+
+    etimer_overhead = 0xffffffff;
+    for (pass = 0; pass < 4; pass++) {
+        etimer_freq = ReadEClock(&eclk_start);
+        ReadEClock(&eclk_end);
+        if (etimer_overhead > eclk_end.ev_lo - eclk_start.ev_lo)
+            etimer_overhead = eclk_end.ev_lo - eclk_start.ev_lo;
+    }
+}
+
+static void
+etimer_start(etimer_t *timer)
+{
+    ReadEClock(&timer->start);
+}
+
+/*
+ * etimer_lap() - return ticks since etimer_start(), without stopping
+ */
+static uint32_t
+etimer_lap(etimer_t *timer)
+{
+    struct EClockVal eclk_now;
+    uint32_t         ticks;
+
+    ReadEClock(&eclk_now);
+    ticks = eclk_now.ev_lo - timer->start.ev_lo;
+    return ((ticks > etimer_overhead) ? ticks - etimer_overhead : 0);
+}
+
+/*
+ * etimer_stop() - return ticks since etimer_start(), and add them to the
+ *                 timer's total
+ */
+static uint32_t
+etimer_stop(etimer_t *timer)
+{
+    uint32_t ticks = etimer_lap(timer);
+
+    acc64_add(&timer->total, ticks);
+    return (ticks);
+}
+
+/*
+ * etimer_usec() - convert EClock ticks to microseconds
+ */
+static uint32_t
+etimer_usec(uint32_t ticks)
+{
+    if (ticks < 400000)
+        return ((ticks * 10000 / (etimer_freq / 10)) * 10);
+    return (ticks / (etimer_freq / 1000) * 1000);
+}
+
+/*
+ * Per-phase timing for TIMING.  Wall time is measured around each phase
+ * by c_main().  Tests add the time they spend with interrupts disabled,
+ * and the bytes of memory they read and write in that time, with
+ * timing_irqoff().  These are also kept per bank.
+ */
+typedef struct {
+    acc64_t irqoff;  /* EClock ticks */
+    acc64_t bytes;
+} timing_acc_t;
+
+static struct {
+    acc64_t      wall;
+    timing_acc_t all;
+    timing_acc_t bank[ZIP_BANKS];
+} timing[PHASE_COUNT];
+
+static uint8_t  timing_enabled   = 0;            /* TIMING option */
+static uint     timing_long      = 0;            /* Windows near limit */
+static uint     timing_phase     = PHASE_COUNT;  /* Phase being timed */
+static uint32_t timing_bank_size = 0;
+static etimer_t timing_timer;                    /* Times current phase */
+
+/*
+ * Event trace for TRACE=file.  Records are appended to a ring in chip
+ * memory, so that writing a record never touches the ZIP memory under
+ * test, and is not affected by the Ramsey control setting.  When the
+ * ring is full, the oldest records are overwritten.  The ring is written
+ * to the file at exit.  misc/trace2json.py converts the file to Chrome
+ * trace JSON.
+ *
+ * A window record is written after a section of code has completed.  It
+ * has the EClock time when the section started, and its length in ticks
+ * as the argument.  Other records have the EClock time of the event.
+ */
+#define TRACE_MAGIC       "ZIPTEST TRACE 1"
+#define TRACE_RECORDS     8192
+
+#define TRACE_PHASE       1  /* Window: test phase (addr is phase) */
+#define TRACE_DBITS       2  /* Window: data line test, IRQs off */
+#define TRACE_ADDR        3  /* Window: address line pattern, IRQs off */
+#define TRACE_CELL_BANK   4  /* Window: cell test of one bank */
+#define TRACE_CELL_BLOCK  5  /* Window: cell test of one block, IRQs off */
+#define TRACE_RAMSEY      6  /* Ramsey control write (arg is value) */
+
+typedef struct {
+    uint16_t event;
+    uint8_t  bank;  /* ZIP_BANKS if not in ZIP memory */
+    uint8_t  unused;
+    uint32_t time;  /* EClock ticks */
+    uint32_t addr;
+    uint32_t arg;
+} trace_rec_t;
+
+static const char  *trace_file  = NULL;  /* TRACE= option */
+static trace_rec_t *trace_ring  = NULL;
+static uint32_t     trace_count = 0;     /* Records written to the ring */
+
+/*
+ * addr_to_bank() - return the ZIP bank containing addr, or ZIP_BANKS
+ */
+static uint
+addr_to_bank(uint32_t addr)
+{
+    if ((timing_bank_size == 0) || (addr >= FASTMEM_TOP) ||
+        (addr < FASTMEM_TOP - timing_bank_size * ZIP_BANKS)) {
+        return (ZIP_BANKS);
+    }
+    return ((FASTMEM_TOP - 1 - addr) / timing_bank_size);
+}
+
+/*
+ * trace_record() - append a record to the trace ring
+ */
+static void
+trace_record(uint event, uint32_t time, uint32_t addr, uint32_t arg)
+{
+    trace_rec_t *rec = &trace_ring[trace_count++ % TRACE_RECORDS];
+
+    rec->event = event;
+    rec->bank  = addr_to_bank(addr);
+    rec->time  = time;
+    rec->addr  = addr;
+    rec->arg   = arg;
+}
+
+/*
+ * trace_window() - record a section of code timed by an etimer
+ */
+static void
+trace_window(uint event, uint32_t addr, const etimer_t *timer,
+             uint32_t ticks)
+{
+    if (trace_ring != NULL)
+        trace_record(event, timer->start.ev_lo, addr, ticks);
+}
+
+/*
+ * trace_ramsey() - record a Ramsey control register write made by
+ *                  set_ramsey_control().  RAMSEY_CONTROL_SET() does not
+ *                  record, as ReadEClock() touches timer.device data
+ *                  which may be in the ZIP memory under test.
+ */
+static void
+trace_ramsey(uint control)
+{
+    struct EClockVal eclk;
+
+    if (trace_ring == NULL)
+        return;
+    ReadEClock(&eclk);
+    trace_record(TRACE_RAMSEY, eclk.ev_lo, RAMSEY_CONTROL, control);
+}
+
+/*
+ * trace_open() - allocate the trace ring
+ */
+static int
+trace_open(void)
+{
+    trace_ring = AllocMem(TRACE_RECORDS * sizeof (trace_rec_t),
+                          MEMF_PUBLIC | MEMF_CHIP);
+    if (trace_ring == NULL) {
+        printf("Cannot allocate chip memory for trace\n");
+        return (1);
+    }
+    trace_count = 0;
+    return (0);
+}
+
+/*
+ * trace_close() - write the trace ring to the TRACE= file, oldest record
+ *                 first, and free the ring
+ */
+static void
+trace_close(void)
+{
+    FILE    *fp;
+    uint32_t first = 0;
+    uint32_t pos;
+
+    if (trace_ring == NULL)
+        return;
+    fp = fopen(trace_file, "w");
+    if (fp == NULL) {
+        printf("Cannot write trace to %s\n", trace_file);
+    } else {
+        if (trace_count > TRACE_RECORDS)
+            first = trace_count - TRACE_RECORDS;
+        fprintf(fp, "%s\n", TRACE_MAGIC);
+        fprintf(fp, "FREQ %u\n", etimer_freq);
+        fprintf(fp, "DROPPED %u\n", first);
+        for (pos = first; pos < trace_count; pos++) {
+            trace_rec_t *rec = &trace_ring[pos % TRACE_RECORDS];
+
+            fprintf(fp, "E %u %u %08x %08x %08x\n", rec->event, rec->bank,
+                    rec->time, rec->addr, rec->arg);
+        }
+        fclose(fp);
+        printf("Wrote %u trace records to %s\n", trace_count - first,
+               trace_file);
+    }
+    FreeMem(trace_ring, TRACE_RECORDS * sizeof (trace_rec_t));
+    trace_ring = NULL;
+}
+
+/*
+ * timing_begin() and timing_end() - bracket a test phase
+ */
+static void
+timing_begin(uint phase)
+{
+    timing_phase = phase;
+    memset(&timing_timer, 0, sizeof (timing_timer));
+    etimer_start(&timing_timer);
+}
+
+static void
+timing_end(void)
+{
+    uint32_t ticks;
+
+    if (timing_phase < PHASE_COUNT) {
+        ticks = etimer_stop(&timing_timer);
+        acc64_add(&timing[timing_phase].wall, ticks);
+        trace_window(TRACE_PHASE, timing_phase, &timing_timer, ticks);
+    }
+    timing_phase = PHASE_COUNT;
+}
+
+/*
+ * timing_irqoff() - account interrupt-disabled time and bytes touched
+ *                   at addr in the current phase
+ */
+static void
+timing_irqoff(uint32_t addr, uint32_t ticks, uint32_t bytes)
+{
+    uint bank = addr_to_bank(addr);
+
+    if (!timing_enabled || (timing_phase >= PHASE_COUNT))
+        return;
+    if (ticks > ETIMER_IRQOFF_MAX / 4 * 3)
+        timing_long++;
+    acc64_add(&timing[timing_phase].all.irqoff, ticks);
+    acc64_add(&timing[timing_phase].all.bytes, bytes);
+    if (bank < ZIP_BANKS) {
+        acc64_add(&timing[timing_phase].bank[bank].irqoff, ticks);
+        acc64_add(&timing[timing_phase].bank[bank].bytes, bytes);
+    }
+}
+
+/*
+ * timing_eta() - estimate seconds remaining in the current phase, given
+ *                that done of total units of work have completed
+ */
+static uint
+timing_eta(uint done, uint total)
+{
+    uint32_t msec = etimer_lap(&timing_timer) / (etimer_freq / 1000);
+
+    if ((done == 0) || (done >= total))
+        return (0);
+    return (msec / done * (total - done) / 1000);
+}
+
+/*
+ * timing_row() - show one line of the timing report.  Throughput is
+ *                based on the wall time if known, otherwise on the time
+ *                with interrupts disabled.
+ */
+static void
+timing_row(const char *phase, const char *bank, uint32_t wall_ms,
+           const timing_acc_t *acc)
+{
+    uint32_t irqoff_ms = acc64_div(&acc->irqoff, etimer_freq / 1000);
+    uint32_t kbytes    = acc64_div(&acc->bytes, 1024);
+    uint32_t msec      = (wall_ms != 0) ? wall_ms : irqoff_ms;
+    uint32_t kbps      = 0;
+
+    if (msec != 0)
+        kbps = kbytes / msec * 1000 + kbytes % msec * 1000 / msec;
+    if (wall_ms != 0)
+        printf("  %-6s %-4s %9u", phase, bank, wall_ms);
+    else
+        printf("  %-6s %-4s %9s", phase, bank, "-");
+    printf(" %10u %10u %4u.%02u\n", irqoff_ms, kbytes, kbps / 1024,
+           kbps % 1024 * 100 / 1024);
+}
+
+/*
+ * timing_report() - show the TIMING report for all phases which ran
+ */
+static void
+timing_report(void)
+{
+    uint phase;
+    uint bank;
+
+    printf("\nTiming (MB/s is for wall time; per bank, for IRQ off time)\n"
+           "  Phase  Bank   Wall ms IRQ off ms     KBytes    MB/s\n"
+           "  ------ ---- --------- ---------- ---------- -------\n");
+    for (phase = 0; phase < PHASE_COUNT; phase++) {
+        uint32_t wall_ms = acc64_div(&timing[phase].wall, etimer_freq / 1000);
+
+        if ((timing[phase].wall.hi | timing[phase].wall.lo) == 0)
+            continue;
+        if (wall_ms == 0)
+            wall_ms = 1;
+        timing_row(phase_names[phase], "all", wall_ms, &timing[phase].all);
+        for (bank = 0; bank < ZIP_BANKS; bank++) {
+            char name[4];
+
+            if ((timing[phase].bank[bank].bytes.hi |
+                 timing[phase].bank[bank].bytes.lo) == 0) {
+                continue;
+            }
+            sprintf(name, "%u", bank);
+            timing_row("", name, 0, &timing[phase].bank[bank]);
+        }
+    }
+    if (timing_long != 0) {
+        printf("  %u IRQ off windows were near the EClock limit, so some "
+               "times may be low\n", timing_long);
+    }
+}
+
+/*
+ * test_value() writes a value to memory and reads it back, returning the
+ *              result.  In order to avert bus capacitance causing false
+ *              "good" values, a disturb value to different memory is
+ *              emitted before the written value is read back from memory.
+ */
+static uint32_t
+test_value(uint32_t addr, uint32_t value)
+{
+    uint32_t orig_zip;
+    uint32_t flip_zip;
+    uint32_t flip_addr;
+    uint32_t result;
+
+    flip_addr = addr ^ 0x0400000;  // Choose another fastmem bank
+
+    orig_zip           = *ADDR32(addr);
+    flip_zip           = *ADDR32(flip_addr);
+    *ADDR32(addr)      = value;
+    CACHE_LINE_FLUSH(ADDR32(addr), 16);
+    *ADDR32(flip_addr) = ~value;
+    CACHE_LINE_FLUSH(ADDR32(flip_addr), 16);
+    result             = *ADDR32(addr);
+    *ADDR32(addr)      = orig_zip;
+    *ADDR32(flip_addr) = flip_zip;
+
+    return (result);
+}
+
+/*
+ * Perform a simple data line test on the memory by walking through a set
+ * of patterns designed to expose bad components or solder joints.
+ * Address lines are left at 0 for this test, so if they are stuck high
+ * or stuck low it should not matter.  If they are floating, then bad data
+ * lines might be reported here.
+ */
+static uint32_t
+test_dbits(uint32_t addr, uint bitvals, uint32_t *bits_and, uint32_t *bits_or,
+           uint flags)
+{
+    uint32_t result_and  = 0xffffffff;
+    uint32_t result_or   = 0;
+    uint32_t result_diff = 0;
+    uint32_t result;
+    uint32_t test_seq[6];
+    uint     pos;
+    uint     count;
+    uint     passes = (flags & FLAG_LONG_TEST) ? 2048 : 512;
+    uint32_t ticks;
+    etimer_t timer;
+
+    /* Push out previous output */
+    fflush(stdout);
+
+    test_seq[0] = 0x00000000;  /* Test stuck high */
+    test_seq[1] = 0xffffffff;  /* Test stuck low */
+    test_seq[2] = bitvals;     /* Test only interesting bits high (floating) */
     test_seq[3] = ~bitvals;    /* Test only interesting bits low (floating) */
     test_seq[4] = 0xa5a5a5a5;  /* Set every other bit (floating) */
     test_seq[5] = 0x5a5a5a5a;  /* Set every other bit (floating) */
@@ -920,6 +2001,7 @@ test_dbits(uint32_t addr, uint bitvals, uint32_t *bits_and, uint32_t *bits_or,
     SUPERVISOR_STATE_ENTER();
     INTERRUPTS_DISABLE();
     MMU_DISABLE();
+    etimer_start(&timer);
     for (count = 0; count < passes; count++) {
         for (pos = 0; pos < ARRAY_SIZE(test_seq); pos++) {
             result = test_value(addr, test_seq[pos]);
@@ -928,11 +2010,16 @@ test_dbits(uint32_t addr, uint bitvals, uint32_t *bits_and, uint32_t *bits_or,
             result_diff |= (result ^ test_seq[pos]);
         }
     }
+    ticks = etimer_lap(&timer);
     MMU_RESTORE();
     INTERRUPTS_ENABLE();
     SUPERVISOR_STATE_EXIT();
     CACHE_RESTORE_STATE();
 
+    /* test_value() makes 7 long accesses */
+    timing_irqoff(addr, ticks, passes * ARRAY_SIZE(test_seq) * 7 * 4);
+    trace_window(TRACE_DBITS, addr, &timer, ticks);
+
     *bits_and = result_and;
     *bits_or  = result_or;
     return (result_diff);
@@ -956,6 +2043,7 @@ data_line_test(uint addrbits, uint flags)
     uint32_t result_and  = 0;
     uint32_t result_or   = 0;
     uint32_t result_diff = 0;
+    int      show        = !(flags & FLAG_SUMMARY);
     const char *socket_l1 = "Socket   IO1  IO2  IO3  IO4 ";
     const char *socket_l2 = "-------- ---- ---- ---- ----";
 
@@ -969,18 +2057,26 @@ data_line_test(uint addrbits, uint flags)
         socket_l1 = "Socket   ADDR    IO1  IO2  IO3  IO4 ";
         socket_l2 = "-------- ------- ---- ---- ---- ----";
     }
-    printf("Data line %s\n", (flags & FLAG_SHOW_MAP) ? "map" : "test");
-    printf("  %s  %s\n"
-           "  %s  %s\n", socket_l1, socket_l1, socket_l2, socket_l2);
+    if (show) {
+        printf("Data line %s\n", (flags & FLAG_SHOW_MAP) ? "map" : "test");
+        printf("  %s  %s\n"
+               "  %s  %s\n", socket_l1, socket_l1, socket_l2, socket_l2);
+    }
 
+    marker(MARKER_DATA, MARK_PHASE, MARK_PHASE_START);
     for (pos = 0; pos < ARRAY_SIZE(zip_u_data); pos++) {
         uint     bank   = zip_u_data[pos].bank;
         uint     nibble = zip_u_data[pos].nibble;
         uint32_t addr   = amask_to_address(bank, 0, addrbits);
+        const char *status[4];
 
-        printf("  %s %u.%u", zip_u_data[pos].skt, zip_u_data[pos].bank, nibble);
-        if (flags & FLAG_DEBUG)
-            printf(" %07x", addr + nibble / 2);
+        if (show) {
+            printf("  %s %u.%u", zip_u_data[pos].skt, zip_u_data[pos].bank,
+                   nibble);
+            if (flags & FLAG_DEBUG)
+                printf(" %07x", addr + nibble / 2);
+        }
+        marker(MARKER_DATA, MARK_UNIT_START, bank);
         if (flags & FLAG_SHOW_MAP) {
             for (io_pin = 0; io_pin < 4; io_pin++)
                 printf("  %2u ", zip_u_data[pos].pins[io_pin]);
@@ -988,7 +2084,7 @@ data_line_test(uint addrbits, uint flags)
             bitvals = 0;
             if ((flags & FLAG_SHOW_DIP) && (zip_u_data[pos].bank == 0)) {
                 for (io_pin = 0; io_pin < 4; io_pin++)
-                    printf(" ----");
+                    status[io_pin] = "----";
             } else if (flags & FLAG_LONG_TEST) {
                 for (io_pin = 0; io_pin < 4; io_pin++) {
                     bitvals = BIT(zip_u_data[pos].pins[io_pin]);
@@ -997,8 +2093,10 @@ data_line_test(uint addrbits, uint flags)
                                              &result_or, flags);
                     if (result_diff != 0)
                         errs++;
-                    printf(" %-4s", get_status(bitvals, result_or, result_and,
-                                               result_diff));
+                    status[io_pin] = get_status(bitvals, result_or,
+                                                result_and, result_diff);
+                    if (*status[io_pin] != 'G')
+                        socket_fails[bank][nibble] |= SOCKET_FAIL_IO(io_pin);
                 }
             } else {
                 for (io_pin = 0; io_pin < 4; io_pin++)
@@ -1011,14 +2109,22 @@ data_line_test(uint addrbits, uint flags)
 
                 for (io_pin = 0; io_pin < 4; io_pin++) {
                     bitvals = BIT(zip_u_data[pos].pins[io_pin]);
-                    printf(" %-4s", get_status(bitvals, result_or, result_and,
-                                               result_diff));
+                    status[io_pin] = get_status(bitvals, result_or,
+                                                result_and, result_diff);
+                    if (*status[io_pin] != 'G')
+                        socket_fails[bank][nibble] |= SOCKET_FAIL_IO(io_pin);
                 }
             }
+            if (show) {
+                for (io_pin = 0; io_pin < 4; io_pin++)
+                    printf(" %-4s", status[io_pin]);
+            }
         }
-        if (zip_u_data[pos].position == POS_RIGHT)
+        marker(MARKER_DATA, MARK_UNIT_END, bank);
+        if (show && (zip_u_data[pos].position == POS_RIGHT))
             printf("\n");
     }
+    marker(MARKER_DATA, MARK_PHASE, MARK_PHASE_END);
     if (flags & FLAG_SHOW_DIP) {
         uint     bank = dip_u_data[0].bank;
         uint32_t addr = amask_to_address(bank, 0, addrbits);
@@ -1123,6 +2229,7 @@ address_line_test(uint addrbits, uint flags)
     uint     casbits       = addrbits / 2;
     int      errs          = 0;
     int      show_type     = 0;
+    uint     bad_banks     = 0;
     uint32_t bank_results[ZIP_BANKS];
     uint32_t save_addrs[8];
     uint32_t save_data[8];
@@ -1133,10 +2240,14 @@ address_line_test(uint addrbits, uint flags)
         bad_threshold = 256;
     }
 
-    printf("Address line test\n");
+    if (!(flags & FLAG_SUMMARY))
+        printf("Address line test\n");
     memset(cas_bit_badcount, 0, sizeof (cas_bit_badcount));
 
+    marker(MARKER_ADDR, MARK_PHASE, MARK_PHASE_START);
     for (bank = 0; bank < ZIP_BANKS; bank++) {
+        marker(MARKER_ADDR, MARK_UNIT_START, bank);
+
         /* Walk other bits as both 000..000 and 111..111 */
         for (walk_zero_one = 0; walk_zero_one < walk_count; walk_zero_one++) {
             uint32_t otherbitmask = (BIT(casbits) - 1) * (walk_zero_one & 1);
@@ -1152,8 +2263,12 @@ address_line_test(uint addrbits, uint flags)
                 uint32_t bitm = casbit;
                 uint32_t bith = (casbit + 1) % casbits;            /* +1 */
                 uint32_t maskval = BIT(bitl) | BIT(bitm) | BIT(bith);
+                uint32_t ticks;
+                etimer_t timer;
 
                 uint threebit;
+
+                marker(MARKER_ADDR, MARK_STEP, casbit);
                 for (threebit = 0; threebit < 8; threebit++) {
                     uint32_t orval       = BIT(bitl) * (threebit & 1) |
                                            BIT(bitm) * ((threebit >> 1) & 1) |
@@ -1173,6 +2288,7 @@ address_line_test(uint addrbits, uint flags)
                 SUPERVISOR_STATE_ENTER();
                 INTERRUPTS_DISABLE();
                 MMU_DISABLE();
+                etimer_start(&timer);
 
                 /* Store data and pattern memory */
                 for (cur = 0; cur < ARRAY_SIZE(save_addrs); cur++) {
@@ -1185,10 +2301,14 @@ address_line_test(uint addrbits, uint flags)
                     *ADDR32(save_addrs[cur]) = save_data[cur];
                     save_data[cur] = temp;
                 }
+                ticks = etimer_lap(&timer);
                 MMU_RESTORE();
                 INTERRUPTS_ENABLE();
                 SUPERVISOR_STATE_EXIT();
                 CACHE_RESTORE_STATE();
+                timing_irqoff(save_addrs[0], ticks,
+                              ARRAY_SIZE(save_addrs) * 4 * 4);
+                trace_window(TRACE_ADDR, save_addrs[0], &timer, ticks);
 
                 /* Verify pattern */
                 if (flags & FLAG_MORE_DEBUG)
@@ -1254,9 +2374,25 @@ address_line_test(uint addrbits, uint flags)
                     printf("\n");
             }
         }
+        marker(MARKER_ADDR, MARK_UNIT_END, bank);
+    }
+    marker(MARKER_ADDR, MARK_PHASE, MARK_PHASE_END);
+
+    for (pos = 0; pos < ARRAY_SIZE(zip_u_data); pos++) {
+        uint nibble = zip_u_data[pos].nibble;
+        bank = zip_u_data[pos].bank;
+        for (casbit = 0; casbit < casbits; casbit++) {
+            if (cas_bit_badcount[bank][casbit][nibble] != 0) {
+                socket_fails[bank][nibble] |= SOCKET_FAIL_ADDR;
+                bad_banks |= BIT(bank);
+            }
+        }
     }
+    if (flags & FLAG_SUMMARY)
+        return (errs);
 
-    if (get_mem_types(addrbits, bank_results, flags) == 0)
+    /* Aliased addresses in a bank would corrupt memory during the probe */
+    if (get_mem_types(addrbits, bank_results, bad_banks, flags) == 0)
         show_type = 1;
 
     if (flags & FLAG_DEBUG) {
@@ -1305,7 +2441,7 @@ address_line_test(uint addrbits, uint flags)
         }
         if (show_type) {
             printf(" %-4s", was_bad ? "?" :
-                   (bank_results[bank] & BIT(nibble)) ? "SC" : "FPM");
+                   mem_type_name(bank_results, bank, nibble));
         }
         if (zip_u_data[pos].position == POS_RIGHT)
             printf("\n");
@@ -1334,17 +2470,240 @@ address_line_test(uint addrbits, uint flags)
     return (errs);
 }
 
+#define WATCH_CELL_LONGS 64  /* Longs cell tested per WATCH= check */
+#define WATCH_UPDATE_HZ  16  /* WATCH= status line updates per second */
+#define WATCH_FAIL_IO(x) BIT(x)       /* IO1-IO4 data line failed */
+#define WATCH_FAIL_A(x)  BIT(4 + (x)) /* A0-A9 address line failed */
+#define WATCH_FAIL_CELL  BIT(14)      /* Memory cell failed */
+
+/* Saved memory contents for WATCH= cell check (the stack is too small) */
+static uint32_t watch_save[WATCH_CELL_LONGS];
+
+/*
+ * watch_check() - run one data line, address line, and cell check of a
+ *                 single socket, ignoring all data bits other than those
+ *                 in mask.  Must be called with interrupts and the MMU
+ *                 disabled.  Returns the WATCH_FAIL bits of failed lines.
+ */
+static uint32_t
+watch_check(uint bank, const uint8_t pins[4], uint32_t mask, uint addrbits,
+            uint32_t cell_addr, uint iter)
+{
+    uint32_t fails   = 0;
+    uint32_t diff    = 0;
+    uint32_t base    = amask_to_address(bank, 0, addrbits);
+    uint     casbits = addrbits / 2;
+    volatile uint32_t *cell = ADDR32(cell_addr);
+    uint32_t pattern;
+    uint32_t addrs[11];
+    uint32_t save[11];
+    uint32_t got[11];
+    uint     io_pin;
+    uint     pos;
+
+    /* Data lines: stuck and floating bits at a fixed address */
+    diff |= test_value(base, 0x00000000) & mask;
+    diff |= ~test_value(base, 0xffffffff) & mask;
+    diff |= (test_value(base, mask) ^ mask) & mask;
+    diff |= (test_value(base, ~mask) ^ ~mask) & mask;
+    for (io_pin = 0; io_pin < 4; io_pin++)
+        if (diff & BIT(pins[io_pin]))
+            fails |= WATCH_FAIL_IO(io_pin);
+
+    /* Address lines: a distinct value at each single address bit */
+    addrs[0] = base;
+    for (pos = 0; pos < casbits; pos++) {
+        addrs[pos + 1] = amask_to_address(bank,
+                                          BIT(pos) | BIT(pos + casbits),
+                                          addrbits);
+    }
+    /*
+     * A faulty address line may make addresses alias, so all are saved
+     * before any pattern is written, and restored in reverse order.  The
+     * first address saved then has its original contents restored last.
+     */
+    for (pos = 0; pos <= casbits; pos++)
+        save[pos] = *ADDR32(addrs[pos]);
+    for (pos = 0; pos <= casbits; pos++)
+        *ADDR32(addrs[pos]) = 0x11111111 * (pos + 1);
+    for (pos = 0; pos <= casbits; pos++)
+        got[pos] = *ADDR32(addrs[pos]);
+    for (pos = casbits + 1; pos > 0; pos--)
+        *ADDR32(addrs[pos - 1]) = save[pos - 1];
+    for (pos = 1; pos <= casbits; pos++)
+        if ((got[pos] ^ (0x11111111 * (pos + 1))) & mask)
+            fails |= WATCH_FAIL_A(pos - 1);
+
+    /* Cells: alternating bits, inverted on every other check */
+    pattern = (iter & 1) ? 0x55555555 : 0xaaaaaaaa;
+    diff = 0;
+    for (pos = 0; pos < WATCH_CELL_LONGS; pos++)
+        watch_save[pos] = cell[pos];
+    for (pos = 0; pos < WATCH_CELL_LONGS; pos++)
+        cell[pos] = (pos & 1) ? ~pattern : pattern;
+    for (pos = 0; pos < WATCH_CELL_LONGS; pos++)
+        diff |= cell[pos] ^ ((pos & 1) ? ~pattern : pattern);
+    for (pos = WATCH_CELL_LONGS; pos > 0; pos--)
+        cell[pos - 1] = watch_save[pos - 1];
+    if (diff & mask)
+        fails |= WATCH_FAIL_CELL;
+    return (fails);
+}
+
+/*
+ * watch_line_char() - return the status character of a line in the
+ *                     WATCH= status: 'X' if it failed since the last
+ *                     update, 'x' if it failed earlier, otherwise '.'
+ */
+static char
+watch_line_char(uint32_t bit, uint32_t recent, uint32_t total)
+{
+    if (recent & bit)
+        return ('X');
+    if (total & bit)
+        return ('x');
+    return ('.');
+}
+
+/*
+ * watch_socket() - repeatedly check a single ZIP or DIP socket, updating
+ *                  a status line in place until Ctrl-C is pressed.  This
+ *                  gives immediate feedback while reseating or pressing
+ *                  on a chip.
+ */
+static int
+watch_socket(const char *name, uint addrbits, uint flags)
+{
+    const u_to_bit_t *skt = NULL;
+    uint32_t bank_size = BIT(addrbits) * 4;
+    uint32_t mask      = 0;
+    uint32_t recent    = 0;
+    uint32_t total     = 0;
+    uint32_t checks    = 0;
+    uint32_t bad       = 0;
+    uint32_t permille;
+    uint     casbits   = addrbits / 2;
+    uint     pos;
+    ULONG    freq;
+    struct EClockVal eclk_last;
+    struct EClockVal eclk_now;
+
+    for (pos = 0; pos < ARRAY_SIZE(zip_u_data); pos++)
+        if (stricmp(name, zip_u_data[pos].skt) == 0)
+            skt = &zip_u_data[pos];
+    for (pos = 0; pos < ARRAY_SIZE(dip_u_data); pos++)
+        if (stricmp(name, dip_u_data[pos].skt) == 0)
+            skt = &dip_u_data[pos];
+    if (skt == NULL) {
+        printf("Unknown socket %s (see ASCII for socket names)\n", name);
+        return (1);
+    }
+    for (pos = 0; pos < 4; pos++)
+        mask |= BIT(skt->pins[pos]);
+
+    printf("\nWatching %s %u.%u (Ctrl-C to stop)\n",
+           skt->skt, skt->bank, skt->nibble);
+    freq = ReadEClock(&eclk_last);
+    while (1) {
+        uint32_t fails;
+        uint32_t cell_addr = FASTMEM_TOP - bank_size * (skt->bank + 1) +
+                             (checks * WATCH_CELL_LONGS * 4) % bank_size;
+
+        CACHE_DISABLE_DATA();
+        SUPERVISOR_STATE_ENTER();
+        INTERRUPTS_DISABLE();
+        MMU_DISABLE();
+        fails = watch_check(skt->bank, skt->pins, mask, addrbits, cell_addr,
+                            checks);
+        MMU_RESTORE();
+        INTERRUPTS_ENABLE();
+        SUPERVISOR_STATE_EXIT();
+        CACHE_RESTORE_STATE();
+
+        checks++;
+        if (fails != 0) {
+            bad++;
+            recent |= fails;
+            total  |= fails;
+            if (flags & FLAG_DEBUG)
+                printf("\n  Check %u failed: %04x", checks, fails);
+        }
+
+        ReadEClock(&eclk_now);
+        if (eclk_now.ev_lo - eclk_last.ev_lo < freq / WATCH_UPDATE_HZ)
+            continue;
+        eclk_last = eclk_now;
+
+        permille = (bad < 4000000) ? bad * 1000 / checks :
+                                     bad / (checks / 1000);
+        printf("\r  %-5s %8u ok %8u bad %3u.%u%%  IO ", skt->skt,
+               checks - bad, bad, permille / 10, permille % 10);
+        for (pos = 0; pos < 4; pos++)
+            printf("%c", watch_line_char(WATCH_FAIL_IO(pos), recent, total));
+        printf("  A ");
+        for (pos = 0; pos < casbits; pos++)
+            printf("%c", watch_line_char(WATCH_FAIL_A(pos), recent, total));
+        printf("  Cell %c ",
+               watch_line_char(WATCH_FAIL_CELL, recent, total));
+        fflush(stdout);
+        recent = 0;
+
+        if (SetSignal(0, 0) & SIGBREAKF_CTRL_C) {
+            SetSignal(0, SIGBREAKF_CTRL_C);
+            printf("^C\n");
+            break;
+        }
+    }
+    return (bad != 0);
+}
+
+/*
+ * memory_control_read_usec() - time reading xsize bytes at the specified
+ *                              address with Ramsey temporarily set to the
+ *                              specified control register value
+ */
+static uint32_t
+memory_control_read_usec(uint8_t ramsey_control_new, uint32_t addr, uint xsize)
+{
+    uint8_t  ramsey_control_old = get_ramsey_control();
+    uint     ediff;
+    uint32_t usec;
+    etimer_t timer;
+
+    SUPERVISOR_STATE_ENTER();
+    INTERRUPTS_DISABLE();
+ // CacheClearU();            // Last chance for write-back
+    cpu.dcache_flush();       // Last chance for write-back
+    etimer_start(&timer);     // Interrupts required by ReadEClock()
+    MMU_DISABLE();
+
+    RAMSEY_CONTROL_SET(ramsey_control_new);
+    burst_read_readl(ADDR32(addr), xsize);
+    RAMSEY_CONTROL_SET(ramsey_control_old);
+
+    MMU_RESTORE();
+    cpu.dcache_flush();       // Ensure no corrupt data is retained
+    ediff = etimer_lap(&timer);
+    INTERRUPTS_ENABLE();
+    SUPERVISOR_STATE_EXIT();
+
+#if 0
+    printf("control old=%02x new=%02x ediff=%u\n",
+           ramsey_control_old, ramsey_control_new, ediff);
+#endif
+    usec = etimer_usec(ediff);
+    if (usec == 0)
+        usec = 10;
+
+    return (usec);
+}
+
 static uint32_t
 memory_read_usec(int sc_mode, uint xsize)
 {
     uint8_t  ramsey_control_old;
     uint8_t  ramsey_control_new;
-    uint     ediff;
-    ULONG    freq;
-    uint     calltime;
     uint32_t usec;
-    struct EClockVal eclk_start;
-    struct EClockVal eclk_end;
 
     ramsey_control_old = get_ramsey_control();
     switch (sc_mode) {
@@ -1367,73 +2726,146 @@ memory_read_usec(int sc_mode, uint xsize)
     }
 //  printf("next mode %u xs=%x\n", sc_mode, xsize);
 
-    SUPERVISOR_STATE_ENTER();
-    INTERRUPTS_DISABLE();
-    ReadEClock(&eclk_start);
-    ReadEClock(&eclk_start);
-    ReadEClock(&eclk_end);
-    INTERRUPTS_ENABLE();
-    calltime = eclk_end.ev_lo - eclk_start.ev_lo;
+    marker(MARKER_READ, MARK_UNIT_START, sc_mode);
+    usec = memory_control_read_usec(ramsey_control_new, 0x07c00000, xsize);
+    marker(MARKER_READ, MARK_UNIT_END, sc_mode);
+    return (usec);
+}
 
-    INTERRUPTS_DISABLE();
- // CacheClearU();            // Last chance for write-back
-    cpu_dcache_flush();       // Last chance for write-back
-    ReadEClock(&eclk_start);  // Interrupts required by ReadEClock()
-    MMU_DISABLE();
+/*
+ * Calibration
+ * -----------
+ * calibrate() repeats a measurement until the estimate is known well
+ * enough, rather than taking a fixed number of samples.  After at least
+ * CALIB_MIN_SAMPLES, it stops when the ~95% confidence interval (two
+ * standard errors of the mean) is within the target error, or when a
+ * decision threshold is outside of the interval, so the answer to "is
+ * the estimate above the threshold" can no longer change.  A noisy
+ * machine takes up to CALIB_MAX_SAMPLES.
+ */
+#define CALIB_MIN_SAMPLES 3
+#define CALIB_MAX_SAMPLES 16
+#define CALIB_MAX_DEV     11585  /* Limits sum of squares to 32 bits */
 
-    *ADDR8(RAMSEY_CONTROL) = ramsey_control_new;
-    while (*ADDR8(RAMSEY_CONTROL) != ramsey_control_new)
-        ;
-    burst_read_readl(ADDR32(0x07c00000), xsize);
+typedef struct {
+    uint32_t estimate;  /* Mean of the samples */
+    uint32_t error;     /* Half-width of the ~95% confidence interval */
+    uint32_t max;       /* Largest sample */
+    uint     samples;   /* Number of samples taken */
+} calib_t;
 
-    *ADDR8(RAMSEY_CONTROL) = ramsey_control_old;
-    while (*ADDR8(RAMSEY_CONTROL) != ramsey_control_old)
-        ;
+/*
+ * isqrt() - integer square root
+ */
+static uint32_t
+isqrt(uint32_t value)
+{
+    uint32_t root = 0;
+    uint32_t bit  = BIT(30);
+
+    while (bit > value)
+        bit >>= 2;
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (root);
+}
 
-    MMU_RESTORE();
-    cpu_dcache_flush();       // Ensure no corrupt data is retained
-    freq = ReadEClock(&eclk_end);
-    INTERRUPTS_ENABLE();
-    SUPERVISOR_STATE_EXIT();
+/*
+ * calibrate() - sample a measurement until its confidence interval is
+ *               within target, or excludes threshold (if non-zero)
+ */
+static void
+calibrate(uint32_t (*sample)(uint arg), uint arg, uint32_t target,
+          uint32_t threshold, calib_t *result)
+{
+    uint32_t first = sample(arg);
+    uint32_t value;
+    uint32_t sum2  = 0;
+    int      sum   = 0;
+    uint     n;
+
+    result->max = first;
+    for (n = 1; ; n++) {
+        int      mean_dev = sum / (int) n;
+        uint32_t mean_sq  = (uint32_t) (mean_dev * mean_dev);
+        uint32_t var      = 0;
+        uint32_t dist;
+        int      dev;
+
+        if (sum2 / n > mean_sq)
+            var = (sum2 / n - mean_sq) * n / (n - 1);  // Sample variance
+        result->estimate = first + mean_dev;
+        result->error    = 2 * isqrt(var / n);
+        result->samples  = n;
+
+        if (n >= CALIB_MIN_SAMPLES) {
+            dist = (result->estimate > threshold) ?
+                   result->estimate - threshold : threshold - result->estimate;
+            if ((result->error <= target) ||
+                ((threshold != 0) && (dist > result->error)) ||
+                (n >= CALIB_MAX_SAMPLES)) {
+                break;
+            }
+        }
+
+        value = sample(arg);
+        if (result->max < value)
+            result->max = value;
+        dev = (int) (value - first);
+        if (dev > CALIB_MAX_DEV)
+            dev = CALIB_MAX_DEV;
+        else if (dev < -CALIB_MAX_DEV)
+            dev = -CALIB_MAX_DEV;
+        sum  += dev;
+        sum2 += (uint32_t) (dev * dev);
+    }
+}
+
+#define CPU_BURST_THRESHOLD 1040  /* Burst must be more than 4% faster */
+
+static calib_t cpu_burst_calib;  /* Burst on / off read speed ratio x 1000 */
+
+/*
+ * cpu_burst_sample() - return how many times faster (x 1000) reads of
+ *                      xsize bytes are with Ramsey burst on than off
+ */
+static uint32_t
+cpu_burst_sample(uint xsize)
+{
+    uint32_t usec_off   = memory_read_usec(SC_MODE_NONE, xsize);
+    uint32_t usec_burst = memory_read_usec(SC_MODE_BURST, xsize);
 
-    ediff = eclk_end.ev_lo - eclk_start.ev_lo - calltime;
 #if 0
-    printf("mode=%x control old=%02x new=%02x ediff=%u\n",
-           sc_mode, ramsey_control_old, ramsey_control_new, ediff);
+    printf("usec_off=%u usec_burst=%u\n", usec_off, usec_burst);
 #endif
-    usec = (ediff * 10000 / (freq / 10)) * 10;
-    if (usec == 0)
-        usec = 10;
-
-    return (usec);
+    return (usec_off * 1000 / usec_burst);
 }
 
 /*
  * cpu_can_burst
  * -------------
- * Returns non-zero when the CPU can do burst reads
+ * Returns non-zero when the CPU can do burst reads.  The speed ratio and
+ * its error are left in cpu_burst_calib.
  */
 static int
 cpu_can_burst(void)
 {
-    uint32_t xsize = 1 << 18;  // 256 K  (must not exceed 4MB)
-    uint32_t usec_off;
-    uint32_t usec_burst;
-    uint     pct_x_10;
+    uint32_t xsize = 1 << 16;  // 64 K per sample (must not exceed 4MB)
 
     CACHE_ENABLE_DATA();
     CACHE_ENABLE_BURST();
-    usec_off   = memory_read_usec(SC_MODE_NONE, xsize);
-    usec_burst = memory_read_usec(SC_MODE_BURST, xsize);
+    calibrate(cpu_burst_sample, xsize, 5, CPU_BURST_THRESHOLD,
+              &cpu_burst_calib);
     CACHE_RESTORE_STATE();
 
-    pct_x_10   = usec_off * 1000 / usec_burst;
-#if 0
-    printf("usec_off=%u usec_burst=%u\n", usec_off, usec_burst);
-#endif
-
-    /* Consider anything greater than 4% as burst-capable */
-    return (pct_x_10 > 1040);
+    return (cpu_burst_calib.estimate > CPU_BURST_THRESHOLD);
 }
 
 static void
@@ -1579,6 +3011,38 @@ cia_ticks(void)
     return (lo | (hi2 << 8));
 }
 
+static uint16_t (*refresh_kernel)(uint8_t control) = NULL;
+static uint refresh_kernel_len;
+
+/*
+ * refresh_kernel_open() - copy ramsey_refresh_ticks() to fast memory, so
+ *                         that it is not slowed by chip bus contention.
+ *                         This is done once for a series of measurements.
+ */
+static void
+refresh_kernel_open(void)
+{
+    uint8_t *ptr;
+
+    refresh_kernel_len = (uint) refresh_kernel_open -
+                         (uint) ramsey_refresh_ticks + 16;
+    ptr = AllocMem(refresh_kernel_len, MEMF_PUBLIC | MEMF_FAST);
+    if (ptr != NULL) {
+        CopyMem(ramsey_refresh_ticks, ptr, refresh_kernel_len);
+        CacheClearE(ptr, refresh_kernel_len, CACRF_ClearD | CACRF_ClearI);
+        refresh_kernel = (uint16_t (*)(uint8_t)) ptr;
+    }
+}
+
+static void
+refresh_kernel_close(void)
+{
+    if (refresh_kernel != NULL) {
+        FreeMem(refresh_kernel, refresh_kernel_len);
+        refresh_kernel = NULL;
+    }
+}
+
 static uint
 measure_ramsey_refreshes_per_ms(uint8_t control)
 {
@@ -1588,15 +3052,7 @@ measure_ramsey_refreshes_per_ms(uint8_t control)
     uint    ticks;
     uint    refs;
     struct  EClockVal eclk;
-    uint16_t (*ptr)(uint8_t control);
-    uint    funclen = (uint) measure_ramsey_refreshes_per_ms -
-                      (uint) ramsey_refresh_ticks + 16;
-
-    ptr = AllocMem(funclen, MEMF_PUBLIC | MEMF_FAST);
-    if (ptr != NULL) {
-        CopyMem(ramsey_refresh_ticks, ptr, funclen);
-        CacheClearE(ptr, funclen, CACRF_ClearD | CACRF_ClearI);
-    }
+    uint16_t (*ptr)(uint8_t control) = refresh_kernel;
 
     /*
      * Ensure that control has opposite wrap value of current state,
@@ -1643,26 +3099,32 @@ measure_ramsey_refreshes_per_ms(uint8_t control)
      * period of 4915.2 usecs. The 9.6 usec interval has been verified
      * with a logic analyzer.
      */
-    if (ptr != NULL)
-        FreeMem(ptr, funclen);
     return (refs);
 }
 
+/* Calibration sample of Ramsey refreshes per second */
+static uint32_t
+refresh_sample(uint control)
+{
+    return (measure_ramsey_refreshes_per_ms(control));
+}
+
+#define REFRESH_TARGET 100  /* Refreshes per second (about 0.1%) */
+
 /*
  * get_ramsey_clock
  * ----------------
- * Returns the calculated Ramsey clock speed in KHz
+ * Returns the calculated Ramsey clock speed in KHz, and the error of the
+ * estimate in *error_khz.
  */
 const uint
-get_ramsey_clock(void)
+get_ramsey_clock(uint *error_khz)
 {
     uint8_t  ocontrol = get_ramsey_control();
     uint8_t  ncontrol;
     uint     cycles;
-    uint     pass;
-    uint     refs;
-    uint     refs_max = 0;
     uint     index;
+    calib_t  refs;
 
     index = ocontrol & (RAMSEY_CONTROL_REFRESH0 | RAMSEY_CONTROL_REFRESH1);
     ncontrol = ocontrol;
@@ -1678,20 +3140,26 @@ get_ramsey_clock(void)
             cycles = 372;
             break;
         case RAMSEY_CONTROL_REFRESH0 | RAMSEY_CONTROL_REFRESH1:
+            *error_khz = 0;
             return (0);
     }
 
+    refresh_kernel_open();
     Forbid();
     SUPERVISOR_STATE_ENTER();
-    for (pass = 0; pass < 4; pass++) {
-        refs = measure_ramsey_refreshes_per_ms(ncontrol);
-        if (refs_max < refs)
-            refs_max = refs;
-    }
+    calibrate(refresh_sample, ncontrol, REFRESH_TARGET, 0, &refs);
     SUPERVISOR_STATE_EXIT();
     Permit();
+    refresh_kernel_close();
 
-    return (cycles * refs_max / 1000);
+    /*
+     * Interference such as bus contention or a late Forbid() can only
+     * lower a refresh count, so the largest sample is the best estimate
+     * of the clock.  The mean is only used for the sample count and the
+     * error.
+     */
+    *error_khz = cycles * refs.error / 1000;
+    return (cycles * refs.max / 1000);
 }
 
 /* ramsey_check() - verify the "expected" version of Ramsey is present */
@@ -1724,19 +3192,20 @@ sc_memory_measure_refresh(void)
 {
     uint8_t  ocontrol = get_ramsey_control();
     uint8_t  ncontrol;
-    uint     refs0;
-    uint     refs1;
-    uint     refs2;
+    calib_t  refs[3];
+    uint     pos;
 
     ncontrol = ocontrol & ~(RAMSEY_CONTROL_REFRESH0 | RAMSEY_CONTROL_REFRESH1);
 
+    refresh_kernel_open();
     Forbid();
     SUPERVISOR_STATE_ENTER();
-    refs0 = measure_ramsey_refreshes_per_ms(ncontrol);
-    refs1 = measure_ramsey_refreshes_per_ms(ncontrol | RAMSEY_CONTROL_REFRESH0);
-    refs2 = measure_ramsey_refreshes_per_ms(ncontrol | RAMSEY_CONTROL_REFRESH1);
+    for (pos = 0; pos < 3; pos++)
+        calibrate(refresh_sample, ncontrol | (pos << 5), REFRESH_TARGET, 0,
+                  &refs[pos]);
     SUPERVISOR_STATE_EXIT();
     Permit();
+    refresh_kernel_close();
 
     /*
      * Ramsey Refresh cycles                  ----------measured------------
@@ -1746,7 +3215,161 @@ sc_memory_measure_refresh(void)
      *   2    380       22.8 usec   15.2 usec 372     23.25 usec  14.88 usec
      *   3    infinite  -           -         -       -           -
      */
-    printf("  (156)=%-7u (240)=%-7u (372)=%u\n", refs0, refs1, refs2);
+    printf("  (156)=%u +/-%u  (240)=%u +/-%u  (372)=%u +/-%u\n",
+           refs[0].estimate, refs[0].error, refs[1].estimate, refs[1].error,
+           refs[2].estimate, refs[2].error);
+    printf("  %u, %u, and %u samples\n",
+           refs[0].samples, refs[1].samples, refs[2].samples);
+}
+
+/*
+ * Calibration cache
+ * -----------------
+ * The CPU burst and Ramsey clock calibration results are saved in ENV:
+ * and ENVARC:, keyed on the CPU type, MMU state, and Ramsey version and
+ * control register.  Later runs on the same configuration reuse them
+ * instead of measuring again.  RECAL forces a new measurement.
+ */
+#define CALIB_FILE      "ENV:ziptest.calib"
+#define CALIB_FILE_ARC  "ENVARC:ziptest.calib"
+#define CALIB_MAGIC     "ZIPTEST CALIB 1"
+
+static struct {
+    uint     cpu;             /* Key: CPU type */
+    uint     ramsey_version;  /* Key: Ramsey version */
+    uint     control;         /* Key: Ramsey control register */
+    uint     mmu;             /* Key: MMU was active */
+    uint8_t  loaded;          /* Cache file has been read */
+    uint8_t  have_burst;      /* burst is valid */
+    uint8_t  have_clock;      /* clock_khz and clock_err are valid */
+    calib_t  burst;
+    uint32_t clock_khz;
+    uint32_t clock_err;
+} calib_cache;
+
+static uint8_t calib_recal = 0;  /* RECAL: ignore the cache */
+
+/*
+ * calib_cache_load() - read cached calibration results which match the
+ *                      current hardware configuration
+ */
+static void
+calib_cache_load(void)
+{
+    FILE    *fp;
+    char     line[80];
+    uint     key[4];
+    uint     match = 0;
+    calib_t  burst;
+    uint32_t khz;
+    uint32_t err;
+
+    calib_cache.loaded         = 1;
+    calib_cache.cpu            = cpu_type;
+    calib_cache.ramsey_version = get_ramsey_version();
+    calib_cache.control        = get_ramsey_control();
+    calib_cache.mmu            = mmu_is_active;
+    if (calib_recal)
+        return;
+
+    fp = fopen(CALIB_FILE, "r");
+    if (fp == NULL)
+        fp = fopen(CALIB_FILE_ARC, "r");
+    if (fp == NULL)
+        return;
+    if ((fgets(line, sizeof (line), fp) == NULL) ||
+        (strncmp(line, CALIB_MAGIC, strlen(CALIB_MAGIC)) != 0)) {
+        fclose(fp);
+        return;
+    }
+    while (fgets(line, sizeof (line), fp) != NULL) {
+        if (sscanf(line, "KEY %u %x %x %u", &key[0], &key[1], &key[2],
+                   &key[3]) == 4) {
+            match = (key[0] == calib_cache.cpu) &&
+                    (key[1] == calib_cache.ramsey_version) &&
+                    (key[2] == calib_cache.control) &&
+                    (key[3] == calib_cache.mmu);
+        } else if (!match) {
+            continue;
+        } else if (sscanf(line, "BURST %u %u %u", &burst.estimate,
+                          &burst.error, &burst.samples) == 3) {
+            calib_cache.burst      = burst;
+            calib_cache.have_burst = 1;
+        } else if (sscanf(line, "CLOCK %u %u", &khz, &err) == 2) {
+            calib_cache.clock_khz  = khz;
+            calib_cache.clock_err  = err;
+            calib_cache.have_clock = 1;
+        }
+    }
+    fclose(fp);
+}
+
+/*
+ * calib_cache_save() - write the calibration results to ENV: and ENVARC:
+ */
+static void
+calib_cache_save(void)
+{
+    static const char * const files[] = { CALIB_FILE, CALIB_FILE_ARC };
+    FILE *fp;
+    uint  pos;
+
+    for (pos = 0; pos < ARRAY_SIZE(files); pos++) {
+        fp = fopen(files[pos], "w");
+        if (fp == NULL)
+            continue;
+        fprintf(fp, "%s\n", CALIB_MAGIC);
+        fprintf(fp, "KEY %u %x %x %u\n", calib_cache.cpu,
+                calib_cache.ramsey_version, calib_cache.control,
+                calib_cache.mmu);
+        if (calib_cache.have_burst) {
+            fprintf(fp, "BURST %u %u %u\n", calib_cache.burst.estimate,
+                    calib_cache.burst.error, calib_cache.burst.samples);
+        }
+        if (calib_cache.have_clock) {
+            fprintf(fp, "CLOCK %u %u\n", calib_cache.clock_khz,
+                    calib_cache.clock_err);
+        }
+        fclose(fp);
+    }
+}
+
+/*
+ * cpu_can_burst_cached() - cpu_can_burst(), using the cached result if
+ *                          there is one for this configuration
+ */
+static int
+cpu_can_burst_cached(void)
+{
+    if (!calib_cache.loaded)
+        calib_cache_load();
+    if (calib_cache.have_burst) {
+        cpu_burst_calib = calib_cache.burst;
+        return (cpu_burst_calib.estimate > CPU_BURST_THRESHOLD);
+    }
+    (void) cpu_can_burst();
+    calib_cache.burst      = cpu_burst_calib;
+    calib_cache.have_burst = 1;
+    calib_cache_save();
+    return (cpu_burst_calib.estimate > CPU_BURST_THRESHOLD);
+}
+
+/*
+ * get_ramsey_clock_cached() - get_ramsey_clock(), using the cached result
+ *                             if there is one for this configuration
+ */
+static uint
+get_ramsey_clock_cached(uint *error_khz)
+{
+    if (!calib_cache.loaded)
+        calib_cache_load();
+    if (!calib_cache.have_clock) {
+        calib_cache.clock_khz  = get_ramsey_clock(&calib_cache.clock_err);
+        calib_cache.have_clock = 1;
+        calib_cache_save();
+    }
+    *error_khz = calib_cache.clock_err;
+    return (calib_cache.clock_khz);
 }
 
 
@@ -1801,30 +3424,57 @@ static const uint32_t burst_magic[] = {
 
 #define BURST_WORDS ARRAY_SIZE(burst_magic)
 
+#define SC_PROBE_ROWS  16  /* Rows probed per bank */
+#define SC_CONFIDENT   75  /* Percent; less is shown as "SC?" or "FPM?" */
+
+static uint8_t mem_type_confidence[ZIP_BANKS];
+static uint8_t mem_type_skipped;  /* Banks not probed: address line faults */
+
 /*
- * sc_memory_probe_addr() probe all nibbles at the specified memory address
- *                        for Static Column support.
+ * sc_memory_probe_rows() - probe all nibbles of every bank for Static
+ *                          Column support
+ *
+ * SC_PROBE_ROWS rows spread across the RAS addresses of each bank are
+ * patterned and then burst read, all within a single critical section.
+ * Each row uses a different rotation of the pattern.  The verdict for
+ * each nibble is by majority of the rows, so a single bad cell does not
+ * change the result, and the confidence (percent of rows which agree
+ * with the verdict) is stored in mem_type_confidence[].
+ *
+ * All rows are saved before any is patterned, and restored in reverse
+ * order, so that the original data survives even if rows alias.  Banks
+ * in skip_banks are not touched.
  */
-static uint32_t
-sc_memory_probe_addr(uint32_t addr, uint flags)
+static void
+sc_memory_probe_rows(uint addrbits, uint32_t *bank_results, uint skip_banks,
+                     uint flags)
 {
+    static uint32_t save_data[ZIP_BANKS][SC_PROBE_ROWS][BURST_WORDS];
+    static uint32_t got_data[ZIP_BANKS][SC_PROBE_ROWS][BURST_WORDS];
+    static uint32_t row_addr[ZIP_BANKS][SC_PROBE_ROWS];
     uint8_t  ramsey_control_old;
     uint8_t  ramsey_control_burst;
-    uint32_t save_data[BURST_WORDS];
-    uint32_t got_data[BURST_WORDS];
-    uint32_t word;
-    uint32_t has_sc = BIT(8) - 1;  /* Assume all are Static Column */
+    uint     casbits = addrbits / 2;
+    uint     bank;
+    uint     row;
+    uint     word;
     uint     nibble;
     uint     count;
 
+    for (bank = 0; bank < ZIP_BANKS; bank++) {
+        for (row = 0; row < SC_PROBE_ROWS; row++) {
+            uint32_t ras = (BIT(casbits) / SC_PROBE_ROWS * row + row) &
+                           (BIT(casbits) - 1);
+            row_addr[bank][row] = amask_to_address(bank, ras << casbits,
+                                                   addrbits) & ~0xff;
+        }
+    }
+
     /* Disable Ramsey page mode */
     INTERRUPTS_DISABLE();
     ramsey_control_old = get_ramsey_control();
     ramsey_control_burst = ramsey_control_old | RAMSEY_CONTROL_BURST;
-    if (cpu_type == 68040)
-        ramsey_control_burst |= RAMSEY_CONTROL_PAGE;
-    else
-        ramsey_control_burst |= RAMSEY_CONTROL_WRAP;
+    ramsey_control_burst |= cpu.sc_probe_control;
 
     set_ramsey_control(ramsey_control_old &
                        ~(RAMSEY_CONTROL_BURST | RAMSEY_CONTROL_PAGE));
@@ -1835,81 +3485,321 @@ sc_memory_probe_addr(uint32_t addr, uint flags)
     SUPERVISOR_STATE_ENTER();
     MMU_DISABLE();
 
-    /* Save original data */
-    memcpy(save_data, (void *) ADDR32(addr), sizeof (save_data));
+    /* Save original data of every row before any is patterned */
+    for (bank = 0; bank < ZIP_BANKS; bank++) {
+        if (skip_banks & BIT(bank))
+            continue;
+        for (row = 0; row < SC_PROBE_ROWS; row++) {
+            memcpy(save_data[bank][row], (void *) ADDR32(row_addr[bank][row]),
+                   BURST_WORDS * 4);
+        }
+    }
+
+    /* Fill with rotated burst pattern */
+    for (bank = 0; bank < ZIP_BANKS; bank++) {
+        if (skip_banks & BIT(bank))
+            continue;
+        for (row = 0; row < SC_PROBE_ROWS; row++) {
+            volatile uint32_t *addr = ADDR32(row_addr[bank][row]);
 
-    /* Fill with burst pattern */
-    memcpy((void *) ADDR32(addr), burst_magic, sizeof (burst_magic));
+            for (word = 0; word < BURST_WORDS; word++)
+                addr[word] = burst_magic[(word + row) % BURST_WORDS];
+        }
+    }
 
     /* Ensure data lands in memory */
-    cpu_dcache_flush();
+    cpu.dcache_flush();
 
-    for (count = 0; count < ARRAY_SIZE(got_data) / 4; count++) {
-        burst_test_read(&got_data[count * 4],
-                        ADDR32(addr + count * 0x10), ramsey_control_burst);
+    for (bank = 0; bank < ZIP_BANKS; bank++) {
+        if (skip_banks & BIT(bank))
+            continue;
+        for (row = 0; row < SC_PROBE_ROWS; row++) {
+            for (count = 0; count < BURST_WORDS / 4; count++) {
+                burst_test_read(&got_data[bank][row][count * 4],
+                                ADDR32(row_addr[bank][row] + count * 0x10),
+                                ramsey_control_burst);
+            }
+        }
     }
 
-    /* Restore original data */
-    memcpy((void *) ADDR32(addr), save_data, sizeof (save_data));
+    /* Restore original data in reverse order */
+    for (bank = ZIP_BANKS; bank > 0; bank--) {
+        if (skip_banks & BIT(bank - 1))
+            continue;
+        for (row = SC_PROBE_ROWS; row > 0; row--) {
+            memcpy((void *) ADDR32(row_addr[bank - 1][row - 1]),
+                   save_data[bank - 1][row - 1], BURST_WORDS * 4);
+        }
+    }
 
     MMU_RESTORE();
-    cpu_dcache_flush();
+    cpu.dcache_flush();
     SUPERVISOR_STATE_EXIT();
     CACHE_RESTORE_STATE();
     INTERRUPTS_ENABLE();
 
-    /* Check for match of expected values */
-    for (word = 0; word < BURST_WORDS; word++) {
-        for (nibble = 0; nibble < 8; nibble++) {
-            uint nibble_value = (got_data[word] >> (nibble * 4)) & 0xf;
-            uint sc_expected = (burst_magic[word] >> (nibble * 4)) & 0xf;
-            if (nibble_value != sc_expected) {
-                /* Nibble did not match -- not Static Column */
-                has_sc &= ~BIT(nibble);
+    /* Vote on each nibble: SC only if the row read back as written */
+    for (bank = 0; bank < ZIP_BANKS; bank++) {
+        uint sc_votes[8];
+        uint confidence = 100;
+
+        if (skip_banks & BIT(bank)) {
+            bank_results[bank] = 0;
+            mem_type_confidence[bank] = 0;
+            continue;
+        }
+        memset(sc_votes, 0, sizeof (sc_votes));
+        for (row = 0; row < SC_PROBE_ROWS; row++) {
+            uint has_sc = BIT(8) - 1;
+
+            for (word = 0; word < BURST_WORDS; word++) {
+                uint32_t diff = got_data[bank][row][word] ^
+                                burst_magic[(word + row) % BURST_WORDS];
+                for (nibble = 0; nibble < 8; nibble++)
+                    if (diff & (0xfU << (nibble * 4)))
+                        has_sc &= ~BIT(nibble);
             }
+            for (nibble = 0; nibble < 8; nibble++)
+                if (has_sc & BIT(nibble))
+                    sc_votes[nibble]++;
         }
-    }
-    if (flags & FLAG_DEBUG) {
-        printf("%08x %08x %08x %08x\n",
-               got_data[0], got_data[1], got_data[2], got_data[3]);
-    }
-
-    return (has_sc);
-}
-
-static int
-get_mem_types(uint addrbits, uint32_t *bank_results, uint flags)
-{
-    uint bank;
 
-    if (!cpu_can_do_burst)
-        return (1);
+        bank_results[bank] = 0;
+        for (nibble = 0; nibble < 8; nibble++) {
+            uint agree = sc_votes[nibble];
 
-    memset(bank_results, 0, sizeof (*bank_results) * ZIP_BANKS);
+            if (sc_votes[nibble] * 2 > SC_PROBE_ROWS)
+                bank_results[bank] |= BIT(nibble);
+            else
+                agree = SC_PROBE_ROWS - sc_votes[nibble];
+            if (confidence > agree * 100 / SC_PROBE_ROWS)
+                confidence = agree * 100 / SC_PROBE_ROWS;
+        }
+        mem_type_confidence[bank] = confidence;
 
-    /* Generate addresses */
-    for (bank = 0; bank < ZIP_BANKS; bank++) {
-        /* Probe all nibbles in bank at the same time */
-        uint32_t addr = amask_to_address(bank, 0, addrbits) & ~0xff;
-        bank_results[bank] = sc_memory_probe_addr(addr, flags);
+        if (flags & FLAG_DEBUG) {
+            printf("  Bank %u: SC votes", bank);
+            for (nibble = 0; nibble < 8; nibble++)
+                printf(" %u", sc_votes[nibble]);
+            printf(" of %u, confidence %u%%\n", SC_PROBE_ROWS, confidence);
+        }
     }
-    return (0);
 }
 
 /*
- * sc_memory_probe() - probe all memory for Static Column support
+ * Timing-based Static Column detection, for CPUs which can not burst
  *
- * Static column memory supports burst read/write operations from the CPU.
- * Unfortunately, this burst mode doesn't seem to be supported by most
- * accelerators (A3640 for example), so the test will only give reliable
- * results with the onboard 68030.
+ * With Ramsey Page mode enabled, Ramsey holds RAS and CAS low between
+ * accesses to the same row and only changes the column address.  Static
+ * Column DRAM follows the column address, but Fast Page Mode DRAM only
+ * latches a new column on a falling CAS edge, so it keeps returning data
+ * from the first column read.  Back-to-back single reads of consecutive
+ * longs in one row, with patterns where every nibble changes from each
+ * long to the next, therefore read correctly from SC parts and return
+ * stale data from FPM parts.  The probe is repeated in several rows with
+ * rotated patterns, and the verdict for each nibble is by majority.
  *
- * The test works by capturing memory contents, patterning those contents
- * with a burst write, reading those pattern contents back, restoring the
- * original contents, and then comparing the pattern contents with what
- * was written.
+ * This only works if Ramsey actually keeps the page open for the CPU's
+ * accesses, which is checked by timing sequential reads of the bank with
+ * Page mode off and on.  If Page mode is not measurably faster and no
+ * nibble showed stale data, the result could be a false SC verdict, so
+ * the confidence is reduced.
  */
-static void
+#define SC_TIMED_TRIALS    8
+#define SC_TIMED_MIN_GAIN  3   /* Percent faster with Page mode */
+
+/*
+ * sc_memory_timed_trial() - write a rotated pattern to one row with Page
+ *                           mode off, then read it back with Page mode off
+ *                           (reference) and on.  Returns the nibbles which
+ *                           read correctly with Page mode on in the low
+ *                           8 bits, and the nibbles which read correctly
+ *                           with Page mode off in the high 8 bits.
+ */
+static uint
+sc_memory_timed_trial(uint32_t addr, uint rotate)
+{
+    static uint32_t save_data[BURST_WORDS];
+    static uint32_t pattern[BURST_WORDS];
+    static uint32_t ref_data[BURST_WORDS];
+    static uint32_t got_data[BURST_WORDS];
+    uint8_t  ocontrol = get_ramsey_control();
+    uint8_t  control  = ocontrol & ~(RAMSEY_CONTROL_BURST |
+                                     RAMSEY_CONTROL_PAGE);
+    uint     good_ref = BIT(8) - 1;
+    uint     good_got = BIT(8) - 1;
+    uint     word;
+    uint     nibble;
+
+    for (word = 0; word < BURST_WORDS; word++)
+        pattern[word] = burst_magic[(word + rotate) % BURST_WORDS];
+
+    INTERRUPTS_DISABLE();
+    CACHE_DISABLE_DATA();
+    SUPERVISOR_STATE_ENTER();
+    MMU_DISABLE();
+    RAMSEY_CONTROL_SET(control);
+    memcpy(save_data, (void *) ADDR32(addr), sizeof (save_data));
+    memcpy((void *) ADDR32(addr), pattern, sizeof (pattern));
+    burst_copy(ref_data, ADDR32(addr), sizeof (ref_data));
+
+    /* movem.l reads consecutive longs in back-to-back bus cycles */
+    RAMSEY_CONTROL_SET(control | RAMSEY_CONTROL_PAGE);
+    burst_copy(got_data, ADDR32(addr), sizeof (got_data));
+    RAMSEY_CONTROL_SET(control);
+
+    memcpy((void *) ADDR32(addr), save_data, sizeof (save_data));
+    RAMSEY_CONTROL_SET(ocontrol);
+    MMU_RESTORE();
+    cpu.dcache_flush();
+    SUPERVISOR_STATE_EXIT();
+    CACHE_RESTORE_STATE();
+    INTERRUPTS_ENABLE();
+
+    for (word = 0; word < BURST_WORDS; word++) {
+        for (nibble = 0; nibble < 8; nibble++) {
+            uint32_t mask = 0xfU << (nibble * 4);
+            if ((ref_data[word] ^ pattern[word]) & mask)
+                good_ref &= ~BIT(nibble);
+            if ((got_data[word] ^ pattern[word]) & mask)
+                good_got &= ~BIT(nibble);
+        }
+    }
+    return (good_got | (good_ref << 8));
+}
+
+/*
+ * sc_memory_timed_probe() - detect Static Column nibbles of one bank
+ *                           without CPU burst.  The confidence of the
+ *                           result (percent) is stored in
+ *                           mem_type_confidence[].
+ */
+static uint32_t
+sc_memory_timed_probe(uint bank, uint addrbits, uint flags)
+{
+    uint8_t  ocontrol   = get_ramsey_control();
+    uint8_t  control    = ocontrol & ~(RAMSEY_CONTROL_BURST |
+                                       RAMSEY_CONTROL_PAGE);
+    uint32_t bank_size  = BIT(addrbits) * 4;
+    uint32_t base       = FASTMEM_TOP - bank_size * (bank + 1);
+    uint32_t xsize      = 1 << 16;
+    uint32_t usec_off;
+    uint32_t usec_page;
+    uint32_t has_sc     = 0;
+    uint     casbits    = addrbits / 2;
+    uint     confidence = 100;
+    uint     gain       = 0;
+    uint     sc_votes[8];
+    uint     valid[8];
+    uint     trial;
+    uint     nibble;
+
+    CACHE_DISABLE_DATA();
+    usec_off  = memory_control_read_usec(control, base, xsize);
+    usec_page = memory_control_read_usec(control | RAMSEY_CONTROL_PAGE,
+                                         base, xsize);
+    CACHE_RESTORE_STATE();
+    if (usec_off > usec_page)
+        gain = usec_off * 100 / usec_page - 100;
+
+    memset(sc_votes, 0, sizeof (sc_votes));
+    memset(valid, 0, sizeof (valid));
+    for (trial = 0; trial < SC_TIMED_TRIALS; trial++) {
+        uint32_t ras  = (trial * 0x35 + 0x0d) & (BIT(casbits) - 1);
+        uint32_t addr = amask_to_address(bank, ras << casbits, addrbits) &
+                        ~0xff;
+        uint     good = sc_memory_timed_trial(addr, trial * 3);
+
+        for (nibble = 0; nibble < 8; nibble++) {
+            if ((good & BIT(nibble + 8)) == 0)
+                continue;  // Reference read failed: bad cell, not a vote
+            valid[nibble]++;
+            if (good & BIT(nibble))
+                sc_votes[nibble]++;
+        }
+    }
+
+    for (nibble = 0; nibble < 8; nibble++) {
+        uint agree = sc_votes[nibble];
+
+        if (sc_votes[nibble] * 2 > valid[nibble]) {
+            has_sc |= BIT(nibble);
+        } else {
+            agree = valid[nibble] - sc_votes[nibble];
+        }
+        if (confidence > agree * 100 / SC_TIMED_TRIALS)
+            confidence = agree * 100 / SC_TIMED_TRIALS;
+    }
+    if ((has_sc == BIT(8) - 1) && (gain < SC_TIMED_MIN_GAIN))
+        confidence /= 2;  // Page mode may not have taken effect
+    mem_type_confidence[bank] = confidence;
+
+    if (flags & FLAG_DEBUG) {
+        printf("  Bank %u: Page mode %u%% faster, SC nibbles %02x, "
+               "confidence %u%%\n", bank, gain, has_sc, confidence);
+    }
+    return (has_sc);
+}
+
+/*
+ * get_mem_types() - determine which nibbles of each bank are Static Column
+ *
+ * The burst probe of sc_memory_probe_rows() is used when the CPU can
+ * burst.  Otherwise the type is inferred by sc_memory_timed_probe().
+ * Banks in skip_banks (such as those with address line faults) are not
+ * probed, and their type is shown as unknown.
+ */
+static int
+get_mem_types(uint addrbits, uint32_t *bank_results, uint skip_banks,
+              uint flags)
+{
+    uint bank;
+
+    if (ramsey_version == 0x7f)
+        return (1);  // Ramsey-01 does not support SC RAM
+
+    mem_type_skipped = skip_banks;
+    if (cpu_can_do_burst) {
+        sc_memory_probe_rows(addrbits, bank_results, skip_banks, flags);
+        return (0);
+    }
+    for (bank = 0; bank < ZIP_BANKS; bank++) {
+        bank_results[bank] = 0;
+        mem_type_confidence[bank] = 0;
+        if (!(skip_banks & BIT(bank)))
+            bank_results[bank] = sc_memory_timed_probe(bank, addrbits, flags);
+    }
+    return (0);
+}
+
+/*
+ * mem_type_name() - return the memory type string for a ZIP socket from
+ *                   the get_mem_types() results
+ */
+static const char *
+mem_type_name(uint32_t *bank_results, uint bank, uint nibble)
+{
+    if (mem_type_skipped & BIT(bank))
+        return ("?");
+    if (mem_type_confidence[bank] < SC_CONFIDENT)
+        return ((bank_results[bank] & BIT(nibble)) ? "SC?" : "FPM?");
+    return ((bank_results[bank] & BIT(nibble)) ? "SC" : "FPM");
+}
+
+/*
+ * sc_memory_probe() - probe all memory for Static Column support
+ *
+ * Static column memory supports burst read/write operations from the CPU.
+ * Unfortunately, this burst mode doesn't seem to be supported by most
+ * accelerators (A3640 for example), so the test will only give reliable
+ * results with the onboard 68030.
+ *
+ * The test works by capturing memory contents, patterning those contents
+ * with a burst write, reading those pattern contents back, restoring the
+ * original contents, and then comparing the pattern contents with what
+ * was written.
+ */
+static void
 sc_memory_probe(uint addrbits, uint flags)
 {
     uint     pos;
@@ -1929,14 +3819,12 @@ sc_memory_probe(uint addrbits, uint flags)
     freq = ReadEClock(&eclk);
     printf("Ramsey refreshes / second measured using EClock=%u.%02u KHz\n",
            freq / 1000, freq % 1000);
-    for (pos = 0; pos < 8; pos++)
-        sc_memory_measure_refresh();
+    sc_memory_measure_refresh();
     printf("\n");
 
     sc_memory_speed();
-    if (get_mem_types(addrbits, bank_results, flags)) {
-        printf("The installed CPU does not support burst and so it's not\n"
-               "possible to correctly detect installed ZIP memory type.\n");
+    if (get_mem_types(addrbits, bank_results, 0, flags)) {
+        printf("It is not possible to detect installed ZIP memory type.\n");
         return;
     }
 
@@ -1949,17 +3837,22 @@ sc_memory_probe(uint addrbits, uint flags)
         uint     bank   = zip_u_data[pos].bank;
         uint     nibble = zip_u_data[pos].nibble;
         uint32_t addr   = amask_to_address(bank, 0, addrbits) & ~0xff;
-        char    *dram_type;
+        const char *dram_type;
 
         printf("  %s %u.%u %07x ", zip_u_data[pos].skt, zip_u_data[pos].bank,
                nibble, addr + nibble / 2);
 
-        dram_type = (bank_results[bank] & BIT(nibble)) ? "SC" : "FPM";
+        dram_type = mem_type_name(bank_results, bank, nibble);
         if (zip_u_data[pos].position == POS_RIGHT)
             printf("%s\n", dram_type);
         else
             printf("%-4s", dram_type);
     }
+    printf("Type from %s; confidence:",
+           cpu_can_do_burst ? "burst reads" : "Page mode reads");
+    for (pos = 0; pos < ZIP_BANKS; pos++)
+        printf(" bank%u=%u%%", pos, mem_type_confidence[pos]);
+    printf("\n");
 }
 
 /*
@@ -2029,199 +3922,2670 @@ gen_address_strobes(uint addrbits, uint flags)
                     dummy = *ADDR32(*ptr0);
                     dummy = *ADDR32(*ptr1);
                 }
-                ptr0++;
-                ptr1++;
+                ptr0++;
+                ptr1++;
+            }
+        }
+        *ADDR8(AMIGA_PPORT_DATA) = 0x00;
+        MMU_RESTORE();
+        INTERRUPTS_ENABLE();
+        SUPERVISOR_STATE_EXIT();
+        CACHE_RESTORE_STATE();
+    }
+}
+
+/*
+ * STROBE=file
+ * -----------
+ * A strobe script is a text file of steps, one per line:
+ *     bank ras cas read|write [value [repeat]]
+ * Numbers may be decimal or 0x hex, and '#' starts a comment.  Each step
+ * is converted to a physical address with amask_to_address() and
+ * compiled to an unrolled sequence of absolute-address moves in chip
+ * memory, so that the accesses run back to back with the same timing on
+ * every pass.  The sequence is framed by the parallel port data lines
+ * going high and low as an analyzer trigger.
+ */
+#define STROBE_MAX_STEPS       64
+#define STROBE_MAX_ACCESSES    2048
+#define STROBE_MOVEL_ABS_D0    0x2039  /* move.l abs.l,d0 */
+#define STROBE_MOVEL_IMM_ABS   0x23fc  /* move.l #imm,abs.l */
+#define STROBE_MOVEB_IMM_ABS   0x13fc  /* move.b #imm,abs.l */
+#define STROBE_RTS             0x4e75  /* rts */
+
+static struct {
+    uint32_t addr;
+    uint32_t value;
+    uint32_t save;     /* Memory contents before a write step */
+    uint16_t repeat;
+    uint8_t  write;
+} strobe_steps[STROBE_MAX_STEPS];
+
+/*
+ * strobe_script_parse() - read a strobe script into strobe_steps[].
+ *                         Returns the number of steps, or 0 on error.
+ */
+static uint
+strobe_script_parse(const char *filename, uint addrbits)
+{
+    FILE *fp       = fopen(filename, "r");
+    uint  casbits  = addrbits / 2;
+    uint  count    = 0;
+    uint  accesses = 0;
+    uint  lineno   = 0;
+    int   bad      = 0;
+    char  line[80];
+
+    if (fp == NULL) {
+        printf("Cannot read strobe script %s\n", filename);
+        return (0);
+    }
+    while (fgets(line, sizeof (line), fp) != NULL) {
+        char    *ptr = strchr(line, '#');
+        char     op[8];
+        uint     bank;
+        uint32_t ras;
+        uint32_t cas;
+        uint32_t value  = 0;
+        uint32_t repeat = 1;
+        int      fields;
+
+        lineno++;
+        if (ptr != NULL)
+            *ptr = '\0';
+        fields = sscanf(line, "%u %i %i %7s %i %i", &bank, &ras, &cas, op,
+                        &value, &repeat);
+        if (fields <= 0)
+            continue;  // Blank line
+        if ((fields < 4) || (bank >= ZIP_BANKS) || (ras >= BIT(casbits)) ||
+            (cas >= BIT(casbits)) || (repeat == 0) ||
+            ((stricmp(op, "read") != 0) && (stricmp(op, "write") != 0))) {
+            printf("%s line %u: expected bank ras cas read|write "
+                   "[value [repeat]]\n", filename, lineno);
+            bad = 1;
+            break;
+        }
+        if ((count >= STROBE_MAX_STEPS) || (repeat > STROBE_MAX_ACCESSES) ||
+            (accesses + repeat > STROBE_MAX_ACCESSES)) {
+            printf("%s: more than %u steps or %u accesses\n", filename,
+                   STROBE_MAX_STEPS, STROBE_MAX_ACCESSES);
+            bad = 1;
+            break;
+        }
+        accesses += repeat;
+        strobe_steps[count].addr   = amask_to_address(bank,
+                                                      cas | (ras << casbits),
+                                                      addrbits);
+        strobe_steps[count].value  = value;
+        strobe_steps[count].repeat = repeat;
+        strobe_steps[count].write  = (stricmp(op, "write") == 0);
+        count++;
+    }
+    fclose(fp);
+    if (bad)
+        return (0);
+    if (count == 0)
+        printf("%s: no steps\n", filename);
+    return (count);
+}
+
+/*
+ * strobe_script_compile() - generate the unrolled access sequence for
+ *                           the parsed steps in chip memory
+ */
+static uint16_t *
+strobe_script_compile(uint count, uint32_t *codelen)
+{
+    uint      step;
+    uint      rep;
+    uint32_t  words = 2 * 4 + 1;  /* Trigger high and low, rts */
+    uint16_t *code;
+    uint16_t *ip;
+
+    for (step = 0; step < count; step++) {
+        words += strobe_steps[step].repeat *
+                 (strobe_steps[step].write ? 5 : 3);
+    }
+    *codelen = words * 2;
+    code = AllocMem(*codelen, MEMF_PUBLIC | MEMF_CHIP);
+    if (code == NULL)
+        return (NULL);
+
+    ip = code;
+    *(ip++) = STROBE_MOVEB_IMM_ABS;
+    *(ip++) = 0x00ff;
+    *(ip++) = AMIGA_PPORT_DATA >> 16;
+    *(ip++) = (uint16_t) AMIGA_PPORT_DATA;
+    for (step = 0; step < count; step++) {
+        uint32_t addr  = strobe_steps[step].addr;
+        uint32_t value = strobe_steps[step].value;
+
+        for (rep = 0; rep < strobe_steps[step].repeat; rep++) {
+            if (strobe_steps[step].write) {
+                *(ip++) = STROBE_MOVEL_IMM_ABS;
+                *(ip++) = value >> 16;
+                *(ip++) = (uint16_t) value;
+            } else {
+                *(ip++) = STROBE_MOVEL_ABS_D0;
+            }
+            *(ip++) = addr >> 16;
+            *(ip++) = (uint16_t) addr;
+        }
+    }
+    *(ip++) = STROBE_MOVEB_IMM_ABS;
+    *(ip++) = 0x0000;
+    *(ip++) = AMIGA_PPORT_DATA >> 16;
+    *(ip++) = (uint16_t) AMIGA_PPORT_DATA;
+    *(ip++) = STROBE_RTS;
+    CacheClearE(code, *codelen, CACRF_ClearD | CACRF_ClearI);
+    return (code);
+}
+
+/*
+ * strobe_script() - run a compiled strobe script repeatedly until Ctrl-C
+ *
+ * Memory at the addresses written by the script is saved before and
+ * restored after each pass, with interrupts disabled.
+ */
+static int
+strobe_script(const char *filename, uint addrbits, uint flags)
+{
+    uint      count = strobe_script_parse(filename, addrbits);
+    uint      step;
+    uint32_t  passes = 0;
+    uint32_t  codelen;
+    uint16_t *code;
+    uint8_t   old_dir;
+    uint8_t   old_data;
+    void      (*run)(void);
+
+    if (count == 0)
+        return (1);
+    code = strobe_script_compile(count, &codelen);
+    if (code == NULL) {
+        printf("Cannot allocate chip memory for strobe sequence\n");
+        return (1);
+    }
+    run = (void (*)(void)) code;
+    if (flags & FLAG_DEBUG) {
+        for (step = 0; step < count; step++) {
+            printf("  %-5s %08x x%u\n",
+                   strobe_steps[step].write ? "write" : "read",
+                   strobe_steps[step].addr, strobe_steps[step].repeat);
+        }
+        printf("  %u bytes of code at %08x\n", codelen, (uint) code);
+    }
+    printf("Running %s (parport pins high during strobes), Ctrl-C to stop\n",
+           filename);
+
+    old_dir  = *ADDR8(AMIGA_PPORT_DIR);
+    old_data = *ADDR8(AMIGA_PPORT_DATA);
+    *ADDR8(AMIGA_PPORT_DIR) = 0xff;
+    while ((SetSignal(0, 0) & SIGBREAKF_CTRL_C) == 0) {
+        CACHE_DISABLE_DATA();
+        SUPERVISOR_STATE_ENTER();
+        INTERRUPTS_DISABLE();
+        MMU_DISABLE();
+        for (step = 0; step < count; step++)
+            if (strobe_steps[step].write)
+                strobe_steps[step].save = *ADDR32(strobe_steps[step].addr);
+        run();
+        for (step = count; step > 0; step--)
+            if (strobe_steps[step - 1].write)
+                *ADDR32(strobe_steps[step - 1].addr) =
+                                                strobe_steps[step - 1].save;
+        MMU_RESTORE();
+        INTERRUPTS_ENABLE();
+        SUPERVISOR_STATE_EXIT();
+        CACHE_RESTORE_STATE();
+        passes++;
+    }
+    *ADDR8(AMIGA_PPORT_DATA) = old_data;
+    *ADDR8(AMIGA_PPORT_DIR)  = old_dir;
+    SetSignal(0, SIGBREAKF_CTRL_C);
+    printf("^C after %u passes\n", passes);
+    FreeMem(code, codelen);
+    return (0);
+}
+
+/*
+ * TRIGGER
+ * -------
+ * On a cell test mismatch, the parallel port SEL line is raised as a
+ * trigger for a logic analyzer.  A map of the failing nibbles (bit n set
+ * if nibble n failed) is then driven on the parallel port data lines,
+ * and SEL is lowered.  The generated verify kernels call cell_trigger()
+ * in util.asm; trigger_pulse() does the same for the C kernels.
+ */
+static uint8_t trigger_old_ddra;
+static uint8_t trigger_old_dir;
+
+/*
+ * trigger_open() - make the parallel port data and SEL lines outputs
+ */
+static void
+trigger_open(void)
+{
+    trigger_old_ddra = *ADDR8(AMIGA_CIAB_DDRA);
+    trigger_old_dir  = *ADDR8(AMIGA_PPORT_DIR);
+    *ADDR8(AMIGA_CIAB_PRA)  &= ~AMIGA_PPORT_SEL;
+    *ADDR8(AMIGA_CIAB_DDRA) |= AMIGA_PPORT_SEL;
+    *ADDR8(AMIGA_PPORT_DATA) = 0x00;
+    *ADDR8(AMIGA_PPORT_DIR)  = 0xff;
+}
+
+/*
+ * trigger_close() - restore the parallel port data and SEL line
+ *                   directions
+ */
+static void
+trigger_close(void)
+{
+    *ADDR8(AMIGA_CIAB_DDRA)  = trigger_old_ddra;
+    *ADDR8(AMIGA_PPORT_DATA) = 0x00;
+    *ADDR8(AMIGA_PPORT_DIR)  = trigger_old_dir;
+}
+
+/*
+ * trigger_pulse() - signal a mismatch with the specified bits on the
+ *                   parallel port
+ */
+static void
+trigger_pulse(uint32_t diff)
+{
+    uint8_t map = 0;
+    uint    nibble;
+
+    *ADDR8(AMIGA_CIAB_PRA) |= AMIGA_PPORT_SEL;
+    for (nibble = 0; nibble < 8; nibble++)
+        if (diff & (0xf << (nibble * 4)))
+            map |= BIT(nibble);
+    *ADDR8(AMIGA_PPORT_DATA) = map;
+    *ADDR8(AMIGA_CIAB_PRA) &= ~AMIGA_PPORT_SEL;
+}
+
+/* Test patterns (must be a prime number of patterns) */
+static const uint32_t cell_patterns[] = {
+    0xaaaaaaaa, 0x55555555, 0xcccccccc, 0x33333333,
+    0x11111111, 0x22222222, 0x44444444, 0x88888888,
+    0x77777777, 0xeeeeeeee, 0xdddddddd, 0xbbbbbbbb,
+    0x00000000
+};
+
+/* Bytes of each TESTBLOCK_SIZE block which are pattern tested */
+#define CELL_TEST_SIZE 2048
+
+/*
+ * cell_dcache_flush() - make the memory range coherent between writing and
+ *                       verifying patterns.  With CACHEON, the data cache
+ *                       is enabled, so only the lines of the block under
+ *                       test are pushed and invalidated.
+ */
+static void
+cell_dcache_flush(volatile uint32_t *addr, uint32_t size, uint flags)
+{
+    if (flags & FLAG_CACHE_ON)
+        cpu.dcache_flush_range(addr, size);
+    else
+        cpu.dcache_flush();
+}
+
+/*
+ * pattern_check_mem() - run a pattern test on the specified memory range
+ */
+static uint32_t
+pattern_check_mem(volatile uint32_t *addr, size_t size, uint flags)
+{
+    volatile uint32_t *taddr;
+    uint32_t           biterr = 0;
+    uint               pat;
+    size_t             count;
+    uint               iters = ARRAY_SIZE(cell_patterns);
+    uint               iter;
+
+    if (!(flags & FLAG_LONG_TEST))
+        iters = 2;
+    for (iter = 0; iter < iters; iter++) {
+        /* Write pattern set */
+        pat   = iter;
+        taddr = addr;
+        count = size / 4;
+        while (count-- > 0) {
+            *taddr = cell_patterns[pat];
+            if (++pat == iters)
+                pat = 0;
+            taddr++;
+        }
+
+        cell_dcache_flush(addr, size, flags);
+
+        /* Verify pattern set */
+        pat   = iter;
+        taddr = addr;
+        count = size / 4;
+        while (count-- > 0) {
+            uint32_t diff = *taddr ^ cell_patterns[pat];
+            if ((diff != 0) && (flags & FLAG_TRIGGER))
+                trigger_pulse(diff);
+            biterr |= diff;
+            if (++pat == iters)
+                pat = 0;
+            taddr++;
+        }
+    }
+    return (biterr);
+}
+
+/*
+ * Runtime-generated cell test kernels
+ * -----------------------------------
+ * For each starting pattern of pattern_check_mem(), a fill and a verify
+ * function are generated with the pattern values as immediate operands.
+ * The generated code is unrolled in whole pattern sets, up to what fits
+ * in the CPU instruction cache, with a dbf loop around it.  Any
+ * remaining longwords of the block are unrolled after the loop.
+ *
+ * Fill:                              Verify:
+ *     move.l  4(sp),a0                   move.l  4(sp),a0
+ *     move.w  #loops-1,d1                move.l  d2,-(sp)
+ * 1:  move.l  #pat0,(a0)+                moveq   #0,d0
+ *     move.l  #pat1,(a0)+                move.w  #loops-1,d2
+ *     ...                            1:  move.l  (a0)+,d1
+ *     dbf     d1,1b                      eori.l  #pat0,d1
+ *     move.l  #patN,(a0)+  (tail)        or.l    d1,d0
+ *     rts                                ...
+ *                                        dbf     d2,1b
+ *                                        ...     (tail)
+ *                                        move.l  (sp)+,d2
+ *                                        rts
+ *
+ * A zero pattern is written with clr.l and verified without eori.l.
+ * With TRIGGER, the verify function loads cell_trigger() into a1 and
+ * each eori.l is followed by "beq.s 1f; jsr (a1); 1:", so the passing
+ * path only costs a taken branch.
+ */
+#define JIT_MOVEL_4SP_A0   0x206f  /* move.l 4(sp),a0 (+ 0x0004) */
+#define JIT_MOVEW_IMM_D1   0x323c  /* move.w #imm,d1 */
+#define JIT_MOVEW_IMM_D2   0x343c  /* move.w #imm,d2 */
+#define JIT_MOVEL_IMM_A0P  0x20fc  /* move.l #imm,(a0)+ */
+#define JIT_CLRL_A0P       0x4298  /* clr.l (a0)+ */
+#define JIT_MOVEL_A0P_D1   0x2218  /* move.l (a0)+,d1 */
+#define JIT_EORIL_IMM_D1   0x0a81  /* eori.l #imm,d1 */
+#define JIT_ORL_D1_D0      0x8081  /* or.l d1,d0 */
+#define JIT_MOVEL_D2_PUSH  0x2f02  /* move.l d2,-(sp) */
+#define JIT_MOVEL_POP_D2   0x241f  /* move.l (sp)+,d2 */
+#define JIT_MOVEQ_0_D0     0x7000  /* moveq #0,d0 */
+#define JIT_DBF_D1         0x51c9  /* dbf d1,disp16 */
+#define JIT_DBF_D2         0x51ca  /* dbf d2,disp16 */
+#define JIT_RTS            0x4e75  /* rts */
+#define JIT_MOVEAL_IMM_A1  0x227c  /* movea.l #imm,a1 */
+#define JIT_BEQS_2         0x6702  /* beq.s *+4 (skip one word) */
+#define JIT_JSR_A1         0x4e91  /* jsr (a1) */
+
+/* Maximum code words for a kernel, excluding the unrolled instructions */
+#define JIT_OVERHEAD_WORDS 16
+
+/* Maximum code words for each unrolled longword (verify) */
+#define JIT_WORDS_PER_LONG 5
+
+/* Additional code words for each unrolled longword with TRIGGER */
+#define JIT_TRIGGER_WORDS  2
+
+static struct {
+    uint16_t *code;     /* Generated code, NULL if not available */
+    uint32_t  codelen;  /* Bytes allocated for code */
+    uint      iters;    /* Number of fill and verify functions */
+    void      (*fill[ARRAY_SIZE(cell_patterns)])(volatile uint32_t *addr);
+    uint32_t  (*verify[ARRAY_SIZE(cell_patterns)])(volatile uint32_t *addr);
+    uint32_t  delta;    /* Offset from generated code to copy being run */
+} cell_jit;
+
+/*
+ * jit_emit_longs() - emit unrolled fill or verify instructions for the
+ *                    specified number of longwords, starting with the
+ *                    specified pattern
+ */
+static uint16_t *
+jit_emit_longs(uint16_t *ip, int verify, uint start, uint iters, uint count,
+               uint flags)
+{
+    uint pos;
+
+    for (pos = 0; pos < count; pos++) {
+        uint32_t pattern = cell_patterns[(start + pos) % iters];
+
+        if (verify) {
+            *(ip++) = JIT_MOVEL_A0P_D1;
+            if (pattern != 0) {
+                *(ip++) = JIT_EORIL_IMM_D1;
+                *(ip++) = pattern >> 16;
+                *(ip++) = (uint16_t) pattern;
+            }
+            if (flags & FLAG_TRIGGER) {
+                *(ip++) = JIT_BEQS_2;
+                *(ip++) = JIT_JSR_A1;
+            }
+            *(ip++) = JIT_ORL_D1_D0;
+        } else if (pattern == 0) {
+            *(ip++) = JIT_CLRL_A0P;
+        } else {
+            *(ip++) = JIT_MOVEL_IMM_A0P;
+            *(ip++) = pattern >> 16;
+            *(ip++) = (uint16_t) pattern;
+        }
+    }
+    return (ip);
+}
+
+/*
+ * jit_emit_kernel() - emit one fill or verify function for the pattern
+ *                     set which starts at the specified pattern
+ */
+static uint16_t *
+jit_emit_kernel(uint16_t *ip, int verify, uint start, uint iters,
+                uint body_longs, uint loops, uint tail_longs, uint flags)
+{
+    uint16_t *loop_ip;
+
+    *(ip++) = JIT_MOVEL_4SP_A0;
+    *(ip++) = 0x0004;
+    if (verify) {
+        *(ip++) = JIT_MOVEL_D2_PUSH;
+        *(ip++) = JIT_MOVEQ_0_D0;
+        if (flags & FLAG_TRIGGER) {
+            *(ip++) = JIT_MOVEAL_IMM_A1;
+            *(ip++) = (uint32_t) cell_trigger >> 16;
+            *(ip++) = (uint16_t) (uint32_t) cell_trigger;
+        }
+    }
+    if (loops != 0) {
+        *(ip++) = verify ? JIT_MOVEW_IMM_D2 : JIT_MOVEW_IMM_D1;
+        *(ip++) = loops - 1;
+        loop_ip = ip;
+        ip = jit_emit_longs(ip, verify, start, iters, body_longs, flags);
+        *(ip++) = verify ? JIT_DBF_D2 : JIT_DBF_D1;
+        *ip = (uint16_t) ((loop_ip - ip) * 2);  // relative to disp16
+        ip++;
+    }
+    /* body_longs is a multiple of iters, so the tail starts at "start" */
+    ip = jit_emit_longs(ip, verify, start, iters, tail_longs, flags);
+    if (verify)
+        *(ip++) = JIT_MOVEL_POP_D2;
+    *(ip++) = JIT_RTS;
+    return (ip);
+}
+
+/*
+ * jit_cell_open() - generate fill and verify functions for the pattern
+ *                   sets used by pattern_check_mem() on a block of the
+ *                   specified size.  If memory is not available for the
+ *                   code, cell_jit.code remains NULL.
+ */
+static void
+jit_cell_open(uint32_t size, uint flags)
+{
+    uint      iters = ARRAY_SIZE(cell_patterns);
+    uint      icache_bytes;
+    uint      body_longs;
+    uint      loops;
+    uint      tail_longs;
+    uint      iter;
+    uint      kernel_words;
+    uint      long_words = JIT_WORDS_PER_LONG;
+    uint16_t *ip;
+
+    if (!(flags & FLAG_LONG_TEST))
+        iters = 2;
+    if (flags & FLAG_TRIGGER)
+        long_words += JIT_TRIGGER_WORDS;
+
+    /* Size the loop body so that it stays in the instruction cache */
+    icache_bytes = cpu.icache_budget;
+
+    body_longs = icache_bytes / (long_words * 2) / iters * iters;
+    if (body_longs == 0)
+        body_longs = iters;
+    if (body_longs > size / 4)
+        body_longs = size / 4 / iters * iters;
+    loops      = (body_longs == 0) ? 0 : size / 4 / body_longs;
+    tail_longs = size / 4 - loops * body_longs;
+
+    kernel_words = JIT_OVERHEAD_WORDS + (body_longs + tail_longs) * long_words;
+    cell_jit.iters   = iters;
+    cell_jit.codelen = kernel_words * 2 * 2 * iters;
+    cell_jit.code    = AllocMem(cell_jit.codelen, MEMF_PUBLIC | MEMF_CHIP);
+    if (cell_jit.code == NULL)
+        return;
+
+    ip = cell_jit.code;
+    for (iter = 0; iter < iters; iter++) {
+        cell_jit.fill[iter] = (void (*)(volatile uint32_t *)) ip;
+        ip = jit_emit_kernel(ip, 0, iter, iters, body_longs, loops,
+                             tail_longs, flags);
+        cell_jit.verify[iter] = (uint32_t (*)(volatile uint32_t *)) ip;
+        ip = jit_emit_kernel(ip, 1, iter, iters, body_longs, loops,
+                             tail_longs, flags);
+    }
+    CacheClearE(cell_jit.code, cell_jit.codelen, CACRF_ClearD | CACRF_ClearI);
+
+    if (flags & FLAG_DEBUG) {
+        printf("JIT: %u kernels, %u x %u + %u longs, %u bytes at %08x\n",
+               iters * 2, loops, body_longs, tail_longs,
+               (uint) ((ip - cell_jit.code) * 2), (uint) cell_jit.code);
+    }
+}
+
+/*
+ * jit_cell_close() - release the generated cell test functions
+ */
+static void
+jit_cell_close(void)
+{
+    if (cell_jit.code != NULL) {
+        FreeMem(cell_jit.code, cell_jit.codelen);
+        cell_jit.code = NULL;
+    }
+}
+
+/*
+ * jit_pattern_check_mem() - run a pattern test on the specified block
+ *                           using the generated functions.  The result
+ *                           is the same as from pattern_check_mem().
+ */
+static uint32_t
+jit_pattern_check_mem(volatile uint32_t *addr, uint32_t size, uint flags)
+{
+    uint32_t biterr = 0;
+    uint     iter;
+    void     (*fill)(volatile uint32_t *addr);
+    uint32_t (*verify)(volatile uint32_t *addr);
+
+    for (iter = 0; iter < cell_jit.iters; iter++) {
+        fill   = (void (*)(volatile uint32_t *))
+                 ((uint32_t) cell_jit.fill[iter] + cell_jit.delta);
+        verify = (uint32_t (*)(volatile uint32_t *))
+                 ((uint32_t) cell_jit.verify[iter] + cell_jit.delta);
+        fill(addr);
+        cell_dcache_flush(addr, size, flags);
+        biterr |= verify(addr);
+    }
+    return (biterr);
+}
+
+/*
+ * Banks which have passed the cell test in this run, and so may host the
+ * hot kernels while other banks are tested.
+ */
+static uint8_t verified_banks = 0;
+
+/*
+ * Hot kernels
+ * -----------
+ * The program runs from chip memory, so instruction cache misses in the
+ * test loops are slow.  During the cell test, the asm kernels between
+ * hot_kernels_start() and hot_kernels_end() and the generated cell test
+ * code are copied to fast memory which is either outside of ZIP memory
+ * or in a ZIP bank which has been verified.  The copy is moved when the
+ * bank which holds it is about to be tested.  The hot structure always
+ * points to the functions which should be called.
+ */
+static struct {
+    uint8_t  *base;     /* Fast memory copy, NULL if running from chip */
+    uint32_t  size;     /* Bytes allocated at base */
+    uint      bank;     /* ZIP bank of base, or ZIP_BANKS if not ZIP */
+    uint      (*burst_copy)(volatile void *dst, volatile void *src,
+                            uint len);
+    uint32_t  (*block_checksum)(volatile void *src, uint len);
+} hot = { NULL, 0, ZIP_BANKS, burst_copy, block_checksum };
+
+/*
+ * hot_kernels_release() - free fast memory copy of the hot kernels and
+ *                         revert to the chip memory versions
+ */
+static void
+hot_kernels_release(void)
+{
+    if (hot.base != NULL) {
+        FreeMem(hot.base, hot.size);
+        hot.base = NULL;
+    }
+    hot.bank           = ZIP_BANKS;
+    hot.burst_copy     = burst_copy;
+    hot.block_checksum = block_checksum;
+    cell_jit.delta     = 0;
+}
+
+/*
+ * hot_kernels_find() - find free fast memory of the specified size which
+ *                      is outside of ZIP memory (pass 0) or in one of the
+ *                      specified ZIP banks (pass 1), and allocate it
+ */
+static uint8_t *
+hot_kernels_find(uint32_t size, uint32_t bank_size, uint banks, uint pass)
+{
+    struct MemHeader *mh;
+    struct MemChunk  *mc;
+    uint32_t          zip_lo = FASTMEM_TOP - bank_size * ZIP_BANKS;
+    uint8_t          *ptr    = NULL;
+
+    Forbid();
+    for (mh = (struct MemHeader *) SysBase->MemList.lh_Head;
+         (ptr == NULL) && (mh->mh_Node.ln_Succ != NULL);
+         mh = (struct MemHeader *) mh->mh_Node.ln_Succ) {
+        if (!(mh->mh_Attributes & MEMF_FAST))
+            continue;
+        for (mc = mh->mh_First; (ptr == NULL) && (mc != NULL);
+             mc = mc->mc_Next) {
+            uint32_t start = ((uint32_t) mc + 15) & ~15;
+            uint32_t end   = (uint32_t) mc + mc->mc_Bytes;
+            uint     bank;
+
+            if (start + size > end)
+                continue;
+            if (pass == 0) {
+                /* Not ZIP memory: the chunk must not overlap ZIP space */
+                if ((start + size <= zip_lo) || (start >= FASTMEM_TOP))
+                    ptr = AllocAbs(size, (APTR) start);
+                continue;
+            }
+            for (bank = 0; bank < ZIP_BANKS; bank++) {
+                uint32_t bstart = FASTMEM_TOP - bank_size * (bank + 1);
+                uint32_t bend   = FASTMEM_TOP - bank_size * bank;
+
+                /* Clip the chunk to the bank */
+                if (bstart < start)
+                    bstart = start;
+                if (bend > end)
+                    bend = end;
+                if ((banks & BIT(bank)) && (bstart + size <= bend)) {
+                    ptr = AllocAbs(size, (APTR) bstart);
+                    break;
+                }
+            }
+        }
+    }
+    Permit();
+    return (ptr);
+}
+
+/*
+ * hot_kernels_place() - ensure the hot kernels are not in the specified
+ *                       ZIP bank, moving them to other verified fast
+ *                       memory if possible.  If no suitable memory is
+ *                       available, the chip memory versions are used.
+ */
+static void
+hot_kernels_place(uint bank, uint32_t bank_size, uint flags)
+{
+    uint32_t  asm_len = (uint32_t) hot_kernels_end -
+                        (uint32_t) hot_kernels_start;
+    uint32_t  jit_len = (cell_jit.code != NULL) ? cell_jit.codelen : 0;
+    uint32_t  size    = (asm_len + jit_len + 15) & ~15;
+    uint      banks   = verified_banks & ~BIT(bank);
+    uint8_t  *ptr;
+    uint      pass;
+
+    if ((hot.base != NULL) && (hot.bank != bank))
+        return;  // Already somewhere safe
+    hot_kernels_release();
+
+    for (pass = 0; pass < 2; pass++) {
+        ptr = hot_kernels_find(size, bank_size, banks, pass);
+        if (ptr != NULL)
+            break;
+    }
+    if (ptr == NULL)
+        return;
+
+    CopyMem((APTR) hot_kernels_start, ptr, asm_len);
+    if (jit_len != 0) {
+        CopyMem(cell_jit.code, ptr + asm_len, jit_len);
+        cell_jit.delta = (uint32_t) ptr + asm_len - (uint32_t) cell_jit.code;
+    }
+    CacheClearE(ptr, size, CACRF_ClearD | CACRF_ClearI);
+
+    hot.base           = ptr;
+    hot.size           = size;
+    hot.bank           = (pass == 0) ? ZIP_BANKS :
+                         (FASTMEM_TOP - 1 - (uint32_t) ptr) / bank_size;
+    hot.burst_copy     = (uint (*)(volatile void *, volatile void *, uint))
+                         (ptr + ((uint32_t) burst_copy -
+                                 (uint32_t) hot_kernels_start));
+    hot.block_checksum = (uint32_t (*)(volatile void *, uint))
+                         (ptr + ((uint32_t) block_checksum -
+                                 (uint32_t) hot_kernels_start));
+    if (flags & FLAG_DEBUG)
+        printf("\nKernels at %08x (bank %u)\n", (uint) ptr, hot.bank);
+}
+
+/*
+ * show_cell_results() - display per-socket result of a memory cell test
+ */
+static void
+show_cell_results(uint8_t bad_chips[ZIP_BANKS][8], uint flags)
+{
+    uint pos;
+    uint bank;
+
+    printf("  Socket   Result   Socket   Result\n"
+           "  -------- ------   -------- ------\n");
+    for (pos = 0; pos < ARRAY_SIZE(zip_u_data); pos++) {
+        uint nibble = zip_u_data[pos].nibble;
+        bank = zip_u_data[pos].bank;
+        printf("  %s %u.%u %-4s", zip_u_data[pos].skt, zip_u_data[pos].bank,
+               nibble, bad_chips[bank][nibble] ? "!" : "Good");
+        if (zip_u_data[pos].position == POS_RIGHT)
+            printf("\n");
+        else
+            printf("   ");
+    }
+
+    if (flags & FLAG_SHOW_DIP) {
+        int nibble;
+        bank = dip_u_data[0].bank;
+        show_dip_header();
+        printf("     ");
+        for (nibble = 7; nibble >= 0; nibble--)
+            printf(" %-5s", bad_chips[bank][nibble] ? "!" : "Good");
+        printf("\n");
+    }
+}
+
+/*
+ * dma_quiet_enter() - with QUIETDMA, blank the display by turning off
+ *                     bitplane, copper, and sprite DMA so that chip memory
+ *                     accesses of the test do not compete with them.
+ *                     Returns the DMA enables to be passed to
+ *                     dma_quiet_exit().
+ */
+static uint16_t
+dma_quiet_enter(uint flags)
+{
+    uint16_t dmacon;
+
+    if (!(flags & FLAG_QUIET_DMA))
+        return (0);
+    dmacon = *ADDR16(AGNUS_DMACON_R) & AGNUS_DMACON_QUIET;
+    *ADDR16(AGNUS_DMACON_W) = AGNUS_DMACON_QUIET;
+    return (dmacon);
+}
+
+/*
+ * dma_quiet_exit() - restore DMA which was turned off by dma_quiet_enter()
+ */
+static void
+dma_quiet_exit(uint16_t dmacon)
+{
+    if (dmacon != 0)
+        *ADDR16(AGNUS_DMACON_W) = AGNUS_DMACON_SET | dmacon;
+}
+
+#define RESTORE_OK       0  /* Block restored correctly */
+#define RESTORE_RETRIED  1  /* Block restored correctly on retry */
+#define RESTORE_FAILED   2  /* Block contents do not match after retry */
+
+/*
+ * block_restore() - restore a block from its saved copy and verify the
+ *                   restored contents against the checksum taken from
+ *                   the block before it was tested.  On mismatch, the
+ *                   restore is retried once.  This function must be
+ *                   called with interrupts disabled, so it does not
+ *                   report anything; see restore_warn().
+ */
+static uint
+block_restore(volatile uint32_t *addr, uint32_t *save_data, uint32_t size,
+              uint32_t sum)
+{
+    hot.burst_copy((void *) addr, save_data, size);
+    cpu.dcache_flush();
+    if (hot.block_checksum(addr, size) == sum)
+        return (RESTORE_OK);
+
+    hot.burst_copy((void *) addr, save_data, size);
+    cpu.dcache_flush();
+    if (hot.block_checksum(addr, size) == sum)
+        return (RESTORE_RETRIED);
+    return (RESTORE_FAILED);
+}
+
+/*
+ * restore_warn() - report a block_restore() checksum mismatch.  Blocks
+ *                  which had test failures are not reported, as bad
+ *                  cells are expected to not restore correctly.
+ */
+static void
+restore_warn(uint result, uint32_t addr, uint32_t biterr)
+{
+    if ((result == RESTORE_OK) || (biterr != 0))
+        return;
+    printf("\nWARNING: Block %06x did not restore correctly%s\n", addr,
+           (result == RESTORE_RETRIED) ? " (retry succeeded)" :
+           "; system memory may be corrupt");
+}
+
+/*
+ * kb_per_sec() - convert a byte count and elapsed EClock ticks to KB/sec
+ */
+static uint
+kb_per_sec(uint32_t bytes, uint32_t ticks, uint32_t freq)
+{
+    uint32_t msec = ticks / (freq / 1000);
+
+    if (msec == 0)
+        msec = 1;
+    return ((bytes >> 10) * 1000 / msec);
+}
+
+/*
+ * mmu_get_tc_none(), mmu_set_tc_none(), and cpu_dcache_flush_none() stand
+ * in for the MMU and cache functions on CPUs which have neither.
+ */
+static uint32_t
+mmu_get_tc_none(void)
+{
+    return (0);
+}
+
+static void
+mmu_set_tc_none(uint32_t tc)
+{
+    (void) tc;
+}
+
+static void
+cpu_dcache_flush_none(void)
+{
+}
+
+static void
+cpu_dcache_flush_range_none(volatile void *addr, uint len)
+{
+    (void) addr;
+    (void) len;
+}
+
+/*
+ * cpu_dcache_flush_range_030() - the 68030 data cache is only 256 bytes
+ *                                and can not be flushed by line, so the
+ *                                whole cache is flushed.
+ */
+static void
+cpu_dcache_flush_range_030(volatile void *addr, uint len)
+{
+    (void) addr;
+    (void) len;
+    cpu_dcache_flush_030();
+}
+
+/* Bytes read and written by one block test: checksum, save, restore, verify */
+#define CELL_BLOCK_BYTES(flags) \
+        (TESTBLOCK_SIZE * 4 + CELL_TEST_SIZE * 2 * \
+         (((flags) & FLAG_LONG_TEST) ? ARRAY_SIZE(cell_patterns) : 2))
+
+/*
+ * cell_block_test() - save, pattern test, and restore one block
+ *
+ * Interrupts are disabled while the block is tested.  The EClock ticks
+ * taken are added to *ticks.
+ */
+static uint32_t
+cell_block_test(uint32_t addr, uint32_t *save_data, uint flags,
+                uint *restored, uint32_t *ticks)
+{
+    uint32_t biterr;
+    uint32_t sum;
+    uint32_t elapsed;
+    etimer_t timer;
+
+    SUPERVISOR_STATE_ENTER();
+    irq_disable();
+    MMU_DISABLE();
+    etimer_start(&timer);
+    sum = hot.block_checksum(ADDR32(addr), TESTBLOCK_SIZE);
+    hot.burst_copy(save_data, (void *) ADDR32(addr), TESTBLOCK_SIZE);
+    if (cell_jit.code != NULL) {
+        biterr = jit_pattern_check_mem(ADDR32(addr), CELL_TEST_SIZE,
+                                       flags);
+    } else {
+        biterr = pattern_check_mem(ADDR32(addr), CELL_TEST_SIZE, flags);
+    }
+    *restored = block_restore(ADDR32(addr), save_data, TESTBLOCK_SIZE,
+                              sum);
+    elapsed = etimer_lap(&timer);
+    MMU_RESTORE();
+    cpu.dcache_flush();
+    irq_enable();
+    SUPERVISOR_STATE_EXIT();
+
+    *ticks += elapsed;
+    timing_irqoff(addr, elapsed, CELL_BLOCK_BYTES(flags));
+    trace_window(TRACE_CELL_BLOCK, addr, &timer, elapsed);
+    return (biterr);
+}
+
+/*
+ * cpu_ops_init() - select the CPU-specific primitives for the CPU which
+ *                  was detected by get_cpu().  The 68060 shares the 68040
+ *                  MMU and cache instructions.
+ */
+static void
+cpu_ops_init(void)
+{
+    switch (cpu_type) {
+        case 68030:
+            cpu.mmu_get_tc         = mmu_get_tc_030;
+            cpu.mmu_set_tc         = mmu_set_tc_030;
+            cpu.mmu_enable         = BIT(31);
+            cpu.dcache_flush       = cpu_dcache_flush_030;
+            cpu.dcache_flush_range = cpu_dcache_flush_range_030;
+            cpu.sc_probe_control   = RAMSEY_CONTROL_WRAP;
+            cpu.icache_budget      = 240;   // 256 byte I-cache
+            break;
+        case 68040:
+        case 68060:
+            cpu.mmu_get_tc         = mmu_get_tc_040;
+            cpu.mmu_set_tc         = mmu_set_tc_040;
+            cpu.mmu_enable         = BIT(15);
+            cpu.dcache_flush       = cpu_dcache_flush_040;
+            cpu.dcache_flush_range = cpu_dcache_flush_range_040;
+            if (cpu_type == 68040) {
+                cpu.sc_probe_control = RAMSEY_CONTROL_PAGE;
+                cpu.icache_budget    = 2048;  // Half of 4K I-cache
+            } else {
+                cpu.sc_probe_control = RAMSEY_CONTROL_WRAP;
+                cpu.icache_budget    = 4096;  // Half of 8K I-cache
+            }
+            break;
+        default:
+            cpu.mmu_get_tc         = mmu_get_tc_none;
+            cpu.mmu_set_tc         = mmu_set_tc_none;
+            cpu.mmu_enable         = 0;
+            cpu.dcache_flush       = cpu_dcache_flush_none;
+            cpu.dcache_flush_range = cpu_dcache_flush_range_none;
+            cpu.sc_probe_control   = RAMSEY_CONTROL_WRAP;
+            cpu.icache_budget      = 240;   // 68020 256 byte I-cache
+            break;
+    }
+}
+
+#define CELL_COMPARE_BLOCKS 32  /* Blocks tested by cell_cache_compare() */
+
+/*
+ * cell_cache_compare() - measure cell test throughput on a sample of
+ *                        blocks in a verified bank, with the data cache
+ *                        off (flushing the whole cache) and with the data
+ *                        cache on (flushing only the block under test)
+ */
+static void
+cell_cache_compare(uint32_t *save_data, uint32_t bank_size, uint flags)
+{
+    uint     bank;
+    uint     blk;
+    uint     mode;
+    uint     restored;
+    uint     kbps[2];
+    uint32_t biterr;
+    ULONG    freq;
+    struct EClockVal eclk;
+
+    for (bank = 0; bank < ZIP_BANKS; bank++)
+        if (verified_banks & BIT(bank))
+            break;
+    if (bank == ZIP_BANKS)
+        return;  // No bank can be used for measurement
+
+    freq = ReadEClock(&eclk);
+    for (mode = 0; mode < 2; mode++) {
+        uint32_t start = FASTMEM_TOP - bank_size * (bank + 1);
+        uint32_t ticks = 0;
+        uint     mflags = (mode == 0) ? (flags & ~FLAG_CACHE_ON) :
+                                        (flags | FLAG_CACHE_ON);
+
+        CACHE_DISABLE_DATA();
+        if (mode != 0)
+            (void) CacheControl(CACRF_EnableD, CACRF_EnableD);
+        for (blk = 0; blk < CELL_COMPARE_BLOCKS; blk++) {
+            uint32_t addr = start + blk * TESTBLOCK_SIZE;
+            biterr = cell_block_test(addr, save_data, mflags, &restored,
+                                     &ticks);
+            restore_warn(restored, addr, biterr);
+        }
+        CACHE_RESTORE_STATE();
+        kbps[mode] = kb_per_sec(CELL_COMPARE_BLOCKS * TESTBLOCK_SIZE, ticks,
+                                freq);
+    }
+    printf("  %u: %u KB/sec cache off, %u KB/sec cache on", cpu_type,
+           kbps[0], kbps[1]);
+    if (kbps[0] != 0)
+        printf(" (gain %d%%)", (int) (kbps[1] * 100 / kbps[0]) - 100);
+    printf("\n");
+}
+
+/*
+ * cell_record_fail() - record a failing block found by the cell test
+ */
+static void
+cell_record_fail(uint bank, uint32_t addr, uint32_t biterr,
+                 uint8_t bad_chips[ZIP_BANKS][8])
+{
+    uint nibble;
+
+    socket_fails_record(bank, biterr);
+    results_block_record(addr);
+    for (nibble = 0; nibble < 8; nibble++) {
+        if (biterr & 0xf)
+            bad_chips[bank][nibble] = 1;
+        biterr >>= 4;
+    }
+}
+
+/*
+ * cell_suspect_test() - with HISTORY, test the 128K regions which failed
+ *                       in the most recent failing run before the full
+ *                       sweep of all banks.  These regions are tested
+ *                       again by the sweep; the count of failing blocks
+ *                       found here is only used to stop early with
+ *                       FAILFAST.
+ */
+static int
+cell_suspect_test(uint32_t bank_size, uint32_t *save_data,
+                  uint8_t bad_chips[ZIP_BANKS][8], uint flags,
+                  uint32_t *ticks)
+{
+    int      errs   = 0;
+    uint32_t zip_lo = FASTMEM_TOP - bank_size * ZIP_BANKS;
+    uint     reg;
+    uint16_t dmacon;
+
+    if (history.region_count == 0)
+        return (0);
+    if (!(flags & FLAG_SUMMARY))
+        printf("  Suspect regions");
+    for (reg = 0; reg < history.region_count; reg++) {
+        uint32_t region = history.regions[reg];
+        uint32_t addr;
+        uint     bank;
+        uint     goterr = 0;
+
+        if ((region < zip_lo) || (region >= FASTMEM_TOP))
+            continue;
+        bank = (FASTMEM_TOP - 1 - region) / bank_size;
+        hot_kernels_place(bank, bank_size, flags);
+
+        dmacon = dma_quiet_enter(flags);
+        CACHE_DISABLE_DATA();
+        if (flags & FLAG_CACHE_ON)
+            (void) CacheControl(CACRF_EnableD, CACRF_EnableD);
+        for (addr = region; addr <= (region | RESULTS_REGION_MASK);
+             addr += TESTBLOCK_SIZE) {
+            uint32_t biterr;
+            uint     restored;
+
+            biterr = cell_block_test(addr, save_data, flags, &restored,
+                                     ticks);
+            restore_warn(restored, addr, biterr);
+            if (biterr != 0) {
+                cell_record_fail(bank, addr, biterr, bad_chips);
+                goterr++;
+                if (flags & FLAG_FAIL_FAST)
+                    break;
+            }
+        }
+        CACHE_RESTORE_STATE();
+        dma_quiet_exit(dmacon);
+        errs += goterr;
+        if (!(flags & FLAG_SUMMARY)) {
+            printf(" %08x%c", region, goterr ? 'X' : '.');
+            fflush(stdout);
+        }
+        if (goterr && (flags & FLAG_FAIL_FAST))
+            break;
+    }
+    if (!(flags & FLAG_SUMMARY))
+        printf("\n");
+    return (errs);
+}
+
+/*
+ * cell_data_test() - test all ZIP package memory cells
+ *
+ * Algoritm:
+ * 1) Allocate 4k buffer in chip memory
+ * 2) Walk all banks:
+ * 3) Disable interrupts
+ * 4) Walk all memory blocks..
+ * 5) Walk list of memory cell test patterns, writing different pattern to
+ *    each consecutive memory location.
+ * 6) Flush cache
+ * 7) Verify list of patterns against memory locations
+ * 8) Execute above repeatedly, using each pattern as a new starting point
+ * 9) Enable interrupts
+ *
+ * With HISTORY, regions and banks which failed before are tested first.
+ */
+static int
+cell_data_test(uint32_t bank_size, uint flags)
+{
+    int       errs = 0;
+    uint      pos;
+    uint      order[ZIP_BANKS];
+    uint32_t *save_data = AllocMem(TESTBLOCK_SIZE, MEMF_PUBLIC | MEMF_CHIP);
+    uint32_t *diffs     = AllocMem(TESTBLOCK_SIZE, MEMF_PUBLIC | MEMF_CHIP);
+    uint8_t   bad_chips[ZIP_BANKS][8];  /* [banks][nibbles] */
+    uint16_t  dmacon;
+    uint32_t  ticks = 0;
+    uint32_t  bytes = 0;
+    uint      width = bank_size / 0x20000;
+    uint      units = 0;
+    uint      done  = 0;
+    uint      eta;
+    uint8_t   show_eta;
+    char      marks[80];
+    etimer_t  bank_timer;
+    ULONG     eclock_freq;
+    struct EClockVal eclk;
+
+    /* With TIMING, the progress bar is redrawn with an ETA */
+    show_eta = timing_enabled && (timing_phase < PHASE_COUNT) &&
+               (width < sizeof (marks)) && !(flags & FLAG_SUMMARY);
+    if (!(flags & FLAG_SUMMARY))
+        printf("Memory cell test\n");
+    memset(bad_chips, 0, sizeof (bad_chips));
+
+    if ((save_data == NULL) || (diffs == NULL)) {
+        printf("Cannot allocate chip memory for test buffer\n");
+        goto cleanup;
+    }
+
+    memset(diffs, 0, TESTBLOCK_SIZE);
+    eclock_freq = ReadEClock(&eclk);
+    jit_cell_open(CELL_TEST_SIZE, flags);
+
+    marker(MARKER_CELL, MARK_PHASE, MARK_PHASE_START);
+    history_bank_order(bank_size, order);
+    errs = cell_suspect_test(bank_size, save_data, bad_chips, flags, &ticks);
+    if (!(flags & FLAG_FAIL_FAST))
+        errs = 0;  // The sweep tests the suspect regions again
+
+    /* Perform test */
+    for (pos = 0; pos < ZIP_BANKS; pos++) {
+        uint     bank   = order[pos];
+        uint32_t start  = FASTMEM_TOP - bank_size * (bank + 1);
+        uint32_t end    = FASTMEM_TOP - bank_size * bank;
+        uint32_t addr   = start;
+        uint     goterr = 0;
+        int      oerrs  = errs;
+
+        if ((errs != 0) && (flags & FLAG_FAIL_FAST))
+            break;
+        if (flags & FLAG_DEBUG)
+            printf("\nstart=%x end=%x\n", start, end);
+        hot_kernels_place(bank, bank_size, flags);
+        if (!(flags & FLAG_SUMMARY)) {
+            printf("  Bank %u [%*s]\r  Bank %u [",
+                   bank, bank_size / 0x20000, "", bank);
+        }
+        units = 0;
+        marks[0] = '\0';
+
+        marker(MARKER_CELL, MARK_UNIT_START, bank);
+        etimer_start(&bank_timer);
+        dmacon = dma_quiet_enter(flags);
+        CACHE_DISABLE_DATA();
+        if (flags & FLAG_CACHE_ON)
+            (void) CacheControl(CACRF_EnableD, CACRF_EnableD);
+        for (addr = start; addr < end; addr += TESTBLOCK_SIZE) {
+            uint32_t biterr;
+            uint     restored;
+
+            if (!retest_block_wanted(addr))
+                continue;
+            marker(MARKER_CELL, MARK_STEP, addr / TESTBLOCK_SIZE);
+            biterr = cell_block_test(addr, save_data, flags, &restored,
+                                     &ticks);
+            restore_warn(restored, addr, biterr);
+            if (biterr != 0) {
+                if ((errs++ < 10) && (flags & FLAG_DEBUG))
+                    printf("err=%08x at %06x\n", biterr, addr);
+                cell_record_fail(bank, addr, biterr, bad_chips);
+                goterr++;
+                if (flags & FLAG_FAIL_FAST)
+                    break;
+            }
+            if ((addr & 0x1ffff) == 0) {
+                uint nibble;
+//              printf("[%04x %04x %04x]", tval1, tval2, tval3);
+                if (show_eta) {
+                    marks[units++] = goterr ? 'X' : '.';
+                    marks[units] = '\0';
+                    eta = timing_eta(++done, ZIP_BANKS * width);
+                    printf("\r  Bank %u [%-*s] ETA %u:%02u ",
+                           bank, width, marks, eta / 60, eta % 60);
+                    fflush(stdout);
+                } else if (!(flags & FLAG_SUMMARY)) {
+                    printf("%c", goterr ? 'X' : '.');
+                    fflush(stdout);
+                }
+
+                /* Quit early if all nibbles in this bank are bad */
+                if (goterr) {
+                    for (nibble = 0; nibble < 8; nibble++)
+                        if (bad_chips[bank][nibble] == 0)
+                            break;
+                    if (nibble == 8)
+                        break;
+                }
+                goterr = 0;
+            }
+        }
+        CACHE_RESTORE_STATE();
+        dma_quiet_exit(dmacon);
+        marker(MARKER_CELL, MARK_UNIT_END, bank);
+        trace_window(TRACE_CELL_BANK, start, &bank_timer,
+                     etimer_lap(&bank_timer));
+        bytes += addr - start;
+        if ((errs == oerrs) && (addr >= end) && !retest_active)
+            verified_banks |= BIT(bank);
+        else
+            verified_banks &= ~BIT(bank);
+        if (show_eta) {
+            printf("\r  Bank %u [%-*s]%14s\n", bank, width, marks, "");
+        } else if (!(flags & FLAG_SUMMARY)) {
+            if (addr >= end)
+                printf("]");
+            printf("\n");
+        }
+    }
+    marker(MARKER_CELL, MARK_PHASE, MARK_PHASE_END);
+    hot_kernels_release();
+    if ((flags & FLAG_CACHE_ON) && !(flags & FLAG_SUMMARY)) {
+        printf("  Throughput: %u KB/sec with data cache on\n",
+               kb_per_sec(bytes, ticks, eclock_freq));
+        cell_cache_compare(save_data, bank_size, flags);
+    }
+    if (!(flags & FLAG_SUMMARY)) {
+        printf("\n");
+        show_cell_results(bad_chips, flags);
+    }
+
+    jit_cell_close();
+
+cleanup:
+    if (diffs != NULL)
+        FreeMem(diffs, TESTBLOCK_SIZE);
+    if (save_data != NULL)
+        FreeMem(save_data, TESTBLOCK_SIZE);
+    return (errs);
+}
+
+/*
+ * Physical address ranges to be cell tested with RANGE=, such as CPU
+ * card memory or Zorro III memory.  The end of each range is the first
+ * address after the range.
+ */
+#define RANGE_MAX 8
+static struct {
+    uint32_t start;
+    uint32_t end;
+} test_ranges[RANGE_MAX];
+static uint test_range_count = 0;
+
+/*
+ * range_is_memory() - return non-zero if all of start to end is memory
+ *                     known to exec.  Both ends must be in the MemList,
+ *                     and the MemList regions must cover the range
+ *                     without gaps, so that no I/O registers, ROM, or
+ *                     unmapped addresses are written by the test.
+ */
+static int
+range_is_memory(uint32_t start, uint32_t end)
+{
+    struct MemHeader *mh;
+    uint32_t          cur = start;
+    uint32_t          lower;
+    uint32_t          upper;
+
+    if ((TypeOfMem((APTR) start) == 0) || (TypeOfMem((APTR) (end - 1)) == 0))
+        return (0);
+
+    Forbid();
+    while (cur < end) {
+        for (mh = (struct MemHeader *) SysBase->MemList.lh_Head;
+             mh->mh_Node.ln_Succ != NULL;
+             mh = (struct MemHeader *) mh->mh_Node.ln_Succ) {
+            /* The MemHeader is at the start of the memory it manages */
+            lower = (uint32_t) mh;
+            upper = (uint32_t) mh->mh_Upper;
+            if ((cur >= lower) && (cur < upper))
+                break;
+        }
+        if (mh->mh_Node.ln_Succ == NULL)
+            break;  /* Gap */
+        cur = upper;
+    }
+    Permit();
+    return (cur >= end);
+}
+
+/*
+ * range_parse() - parse the start,end[,start,end...] value of RANGE=.
+ *                 Addresses are hexadecimal.  Returns 0 on success.
+ */
+static int
+range_parse(const char *value)
+{
+    char *ptr;
+
+    while (*value != '\0') {
+        uint32_t start;
+        uint32_t end;
+
+        if (test_range_count >= RANGE_MAX) {
+            printf("No more than %u ranges may be specified\n", RANGE_MAX);
+            return (1);
+        }
+        start = strtoul(value, &ptr, 16);
+        if ((ptr == value) || (*ptr != ','))
+            return (1);
+        value = ptr + 1;
+        end = strtoul(value, &ptr, 16);
+        if ((ptr == value) || ((*ptr != ',') && (*ptr != '\0')))
+            return (1);
+        value = (*ptr == ',') ? ptr + 1 : ptr;
+
+        /* Only whole blocks are tested */
+        start = (start + TESTBLOCK_SIZE - 1) & ~(TESTBLOCK_SIZE - 1);
+        end &= ~(TESTBLOCK_SIZE - 1);
+        if (start >= end) {
+            printf("Range %08x-%08x is too small\n", start, end);
+            return (1);
+        }
+        if (start < 0x200000) {
+            printf("Range %08x-%08x includes CHIP memory\n", start, end);
+            return (1);
+        }
+        if (!range_is_memory(start, end)) {
+            printf("Range %08x-%08x is not all system memory\n", start, end);
+            return (1);
+        }
+        test_ranges[test_range_count].start = start;
+        test_ranges[test_range_count].end   = end;
+        test_range_count++;
+    }
+    return (0);
+}
+
+/*
+ * range_show_fail() - display the failing data bits at an address
+ */
+static void
+range_show_fail(uint32_t addr, uint32_t biterr)
+{
+    int bit;
+
+    printf("\n  Fail at %08x:", addr);
+    for (bit = 31; bit >= 0; bit--)
+        if (biterr & BIT(bit))
+            printf(" D%d", bit);
+    printf("\n");
+}
+
+/*
+ * range_test() - test all memory cells in the RANGE= address ranges
+ *
+ * Each block is saved, pattern tested, and restored in the same way as
+ * by cell_data_test().  Failures are reported by address and data bit.
+ * Failures in ZIP memory are also attributed to their sockets.  The hot
+ * kernels are left in chip memory, as the ranges may include any of the
+ * fast memory where they could otherwise be placed.
+ */
+static int
+range_test(uint32_t bank_size, uint flags)
+{
+    int       errs = 0;
+    int       zip  = 0;
+    uint      range;
+    uint32_t *save_data = AllocMem(TESTBLOCK_SIZE, MEMF_PUBLIC | MEMF_CHIP);
+    uint32_t  zip_lo    = FASTMEM_TOP - bank_size * ZIP_BANKS;
+    uint8_t   bad_chips[ZIP_BANKS][8];  /* [banks][nibbles] */
+    uint16_t  dmacon;
+    ULONG     eclock_freq;
+    struct EClockVal eclk;
+
+    if (!(flags & FLAG_SUMMARY))
+        printf("Range test\n");
+    memset(bad_chips, 0, sizeof (bad_chips));
+
+    if (save_data == NULL) {
+        printf("Cannot allocate chip memory for test buffer\n");
+        return (1);
+    }
+
+    eclock_freq = ReadEClock(&eclk);
+    jit_cell_open(CELL_TEST_SIZE, flags);
+    hot_kernels_release();
+
+    for (range = 0; range < test_range_count; range++) {
+        uint32_t start = test_ranges[range].start;
+        uint32_t end   = test_ranges[range].end;
+        uint32_t addr;
+        uint32_t ticks = 0;
+        uint     goterr = 0;
+        uint     shown  = 0;
+
+        if (!(flags & FLAG_SUMMARY))
+            printf("  %08x-%08x [", start, end - 1);
+
+        dmacon = dma_quiet_enter(flags);
+        CACHE_DISABLE_DATA();
+        if (flags & FLAG_CACHE_ON)
+            (void) CacheControl(CACRF_EnableD, CACRF_EnableD);
+        for (addr = start; addr < end; addr += TESTBLOCK_SIZE) {
+            uint32_t biterr;
+            uint     restored;
+
+            if (!retest_block_wanted(addr))
+                continue;
+            biterr = cell_block_test(addr, save_data, flags, &restored,
+                                     &ticks);
+            restore_warn(restored, addr, biterr);
+            if (biterr != 0) {
+                errs++;
+                goterr++;
+                results_block_record(addr);
+                if ((shown++ < 10) && !(flags & FLAG_SUMMARY))
+                    range_show_fail(addr, biterr);
+                if ((addr >= zip_lo) && (addr < FASTMEM_TOP)) {
+                    uint bank   = (FASTMEM_TOP - 1 - addr) / bank_size;
+                    uint nibble;
+
+                    zip = 1;
+                    socket_fails_record(bank, biterr);
+                    for (nibble = 0; nibble < 8; nibble++) {
+                        if (biterr & 0xf)
+                            bad_chips[bank][nibble] = 1;
+                        biterr >>= 4;
+                    }
+                }
+            }
+            if ((addr & 0xfffff) == 0) {
+                if (!(flags & FLAG_SUMMARY)) {
+                    printf("%c", goterr ? 'X' : '.');
+                    fflush(stdout);
+                }
+                goterr = 0;
+            }
+            if (SetSignal(0, 0) & SIGBREAKF_CTRL_C)
+                break;
+        }
+        CACHE_RESTORE_STATE();
+        dma_quiet_exit(dmacon);
+        if (!(flags & FLAG_SUMMARY)) {
+            printf("]%s\n  Throughput: %u KB/sec\n",
+                   (addr < end) ? " ^C" : "",
+                   kb_per_sec(addr - start, ticks, eclock_freq));
+        }
+        if (addr < end)
+            break;
+    }
+    if (zip && !(flags & FLAG_SUMMARY)) {
+        printf("\n");
+        show_cell_results(bad_chips, flags);
+    }
+
+    jit_cell_close();
+    FreeMem(save_data, TESTBLOCK_SIZE);
+    return (errs);
+}
+
+#define DMA_QUIET_COPY_SIZE  16384  /* Chip memory copy for measurement */
+#define DMA_QUIET_COPY_ITERS 16
+
+/*
+ * dma_quiet_chip_kbps() - measure chip memory copy throughput, with or
+ *                         without display DMA
+ */
+static uint
+dma_quiet_chip_kbps(uint32_t *buf, uint flags)
+{
+    uint     best = 0;
+    uint     kbps;
+    uint     pass;
+    uint     iter;
+    uint16_t dmacon;
+    uint32_t ticks;
+    etimer_t timer;
+
+    for (pass = 0; pass < 3; pass++) {
+        Forbid();
+        dmacon = dma_quiet_enter(flags);
+        etimer_start(&timer);
+        for (iter = 0; iter < DMA_QUIET_COPY_ITERS; iter++) {
+            burst_copy(buf, buf + DMA_QUIET_COPY_SIZE / 2 / 4,
+                       DMA_QUIET_COPY_SIZE / 2);
+        }
+        ticks = etimer_lap(&timer);
+        dma_quiet_exit(dmacon);
+        Permit();
+
+        kbps = kb_per_sec(DMA_QUIET_COPY_SIZE / 2 * DMA_QUIET_COPY_ITERS,
+                          ticks, etimer_freq);
+        if (best < kbps)
+            best = kbps;
+    }
+    return (best);
+}
+
+/*
+ * dma_quiet_report() - show chip memory copy throughput with display DMA
+ *                      and with QUIETDMA
+ */
+static void
+dma_quiet_report(void)
+{
+    uint32_t *buf = AllocMem(DMA_QUIET_COPY_SIZE, MEMF_PUBLIC | MEMF_CHIP);
+    uint      kbps_normal;
+    uint      kbps_quiet;
+
+    if (buf == NULL)
+        return;
+    kbps_normal = dma_quiet_chip_kbps(buf, 0);
+    kbps_quiet  = dma_quiet_chip_kbps(buf, FLAG_QUIET_DMA);
+    FreeMem(buf, DMA_QUIET_COPY_SIZE);
+
+    printf("Chip copy: %u KB/sec with display DMA, %u KB/sec with QUIETDMA",
+           kbps_normal, kbps_quiet);
+    if (kbps_normal != 0) {
+        printf(" (gain %d%%)",
+               (int) (kbps_quiet * 100 / kbps_normal) - 100);
+    }
+    printf("\n");
+}
+
+/*
+ * burst_pattern_check_mem() - run a pattern test on the specified memory
+ *                             range, one cache line at a time
+ *
+ * The pattern buffer holds the repeating pattern sequence, so that pattern
+ * set (iter) starts at patbuf[iter].  Each line is written with
+ * burst_copyline() and then read back as a single cache line fill.  The
+ * caller must have Ramsey and the CPU data cache in the desired mode.
+ */
+static uint32_t
+burst_pattern_check_mem(volatile uint32_t *addr, size_t size,
+                        const uint32_t *patbuf, uint iters, uint flags)
+{
+    volatile uint32_t *taddr;
+    const uint32_t    *pat;
+    uint32_t           got[4];
+    uint32_t           biterr = 0;
+    size_t             count;
+    uint               iter;
+
+    for (iter = 0; iter < iters; iter++) {
+        /* Write pattern set, one line at a time */
+        pat   = patbuf + iter;
+        taddr = addr;
+        for (count = size / 16; count > 0; count--) {
+            burst_copyline(taddr, (void *) pat);
+            taddr += 4;
+            pat   += 4;
+        }
+
+        cpu.dcache_flush();
+
+        /* Verify pattern set (each line is read by a cache line fill) */
+        pat   = patbuf + iter;
+        taddr = addr;
+        for (count = size / 16; count > 0; count--) {
+            uint32_t diff;
+
+            burst_copyline(got, taddr);
+            diff = (got[0] ^ pat[0]) | (got[1] ^ pat[1]) |
+                   (got[2] ^ pat[2]) | (got[3] ^ pat[3]);
+            if ((diff != 0) && (flags & FLAG_TRIGGER))
+                trigger_pulse(diff);
+            biterr |= diff;
+            taddr += 4;
+            pat   += 4;
+        }
+    }
+    return (biterr);
+}
+
+/*
+ * cell_burst_test() - test all ZIP package memory cells at full speed
+ *
+ * This is a variant of the memory cell test which runs the pattern fill
+ * and verify with Ramsey in Page and Burst mode and with the CPU data
+ * cache and burst enabled.  Patterns are streamed through memory one cache
+ * line at a time, in address order, so that consecutive lines remain in
+ * the same DRAM page.  Each line is read back by a burst cache line fill,
+ * which will expose Static Column timing failures that the normal cell
+ * test (cache off, Ramsey mode unchanged) can not see.
+ *
+ * At least four patterns are used so that every longword in a line has a
+ * different value than its neighbors.  Memory is saved and restored with
+ * Ramsey in its original mode.
+ */
+static int
+cell_burst_test(uint32_t bank_size, uint flags)
+{
+    int       errs        = 0;
+    uint      bank;
+    uint      pos;
+    uint      iters       = ARRAY_SIZE(cell_patterns);
+    uint32_t  patlen;
+    uint32_t  bytes_total = 0;
+    uint32_t  ticks_total = 0;
+    uint32_t *save_data   = NULL;
+    uint32_t *patbuf      = NULL;
+    uint8_t   ocontrol    = get_ramsey_control();
+    uint8_t   ncontrol    = ocontrol | RAMSEY_CONTROL_PAGE |
+                            RAMSEY_CONTROL_BURST;
+    uint8_t   bad_chips[ZIP_BANKS][8];  /* [banks][nibbles] */
+    uint16_t  dmacon;
+    uint32_t  ticks;
+    etimer_t  timer;
+
+    if (!(flags & FLAG_SUMMARY))
+        printf("Memory cell test (Page + Burst)\n");
+    memset(bad_chips, 0, sizeof (bad_chips));
+
+    if (ramsey_version == 0x7f) {
+        printf("Ramsey-01 does not support SC RAM\n");
+        return (0);
+    }
+    if (!cpu_can_do_burst && !(flags & FLAG_SUMMARY)) {
+        printf("  CPU burst not available: lines will be read without "
+               "burst\n");
+    }
+
+    if (!(flags & FLAG_LONG_TEST))
+        iters = 4;
+    patlen    = TESTBLOCK_SIZE + iters * sizeof (uint32_t);
+    save_data = AllocMem(TESTBLOCK_SIZE, MEMF_PUBLIC | MEMF_CHIP);
+    patbuf    = AllocMem(patlen, MEMF_PUBLIC | MEMF_CHIP);
+    if ((save_data == NULL) || (patbuf == NULL)) {
+        printf("Cannot allocate chip memory for test buffer\n");
+        goto cleanup;
+    }
+    for (pos = 0; pos < patlen / sizeof (uint32_t); pos++)
+        patbuf[pos] = cell_patterns[pos % iters];
+
+    for (bank = 0; bank < ZIP_BANKS; bank++) {
+        uint32_t start      = FASTMEM_TOP - bank_size * (bank + 1);
+        uint32_t end        = FASTMEM_TOP - bank_size * bank;
+        uint32_t addr       = start;
+        uint32_t bank_ticks = 0;
+        uint32_t bank_bytes = 0;
+        uint     goterr     = 0;
+
+        if (flags & FLAG_DEBUG)
+            printf("\nstart=%x end=%x\n", start, end);
+        if (!(flags & FLAG_SUMMARY)) {
+            printf("  Bank %u [%*s]\r  Bank %u [",
+                   bank, bank_size / 0x20000, "", bank);
+        }
+
+        dmacon = dma_quiet_enter(flags);
+        CACHE_ENABLE_DATA();
+        CACHE_ENABLE_BURST();
+        for (addr = start; addr < end; addr += TESTBLOCK_SIZE) {
+            uint32_t biterr;
+            uint32_t sum;
+            uint     restored;
+
+            if (!retest_block_wanted(addr))
+                continue;
+
+            /* Interrupts are disabled in this block */
+            SUPERVISOR_STATE_ENTER();
+            irq_disable();
+            MMU_DISABLE();
+            etimer_start(&timer);
+            sum = block_checksum(ADDR32(addr), TESTBLOCK_SIZE);
+            burst_copy(save_data, (void *) ADDR32(addr), TESTBLOCK_SIZE);
+            cpu.dcache_flush();
+            RAMSEY_CONTROL_SET(ncontrol);
+            biterr = burst_pattern_check_mem(ADDR32(addr), TESTBLOCK_SIZE,
+                                             patbuf, iters, flags);
+            RAMSEY_CONTROL_SET(ocontrol);
+            cpu.dcache_flush();
+            restored = block_restore(ADDR32(addr), save_data,
+                                     TESTBLOCK_SIZE, sum);
+            /* Not before the restore: timer.device data may be in ZIP */
+            ticks = etimer_lap(&timer);
+            MMU_RESTORE();
+            cpu.dcache_flush();
+            irq_enable();
+            SUPERVISOR_STATE_EXIT();
+
+            bank_ticks += ticks;
+            bank_bytes += TESTBLOCK_SIZE * (4 + 2 * iters);
+            timing_irqoff(addr, ticks, TESTBLOCK_SIZE * (4 + 2 * iters));
+
+            restore_warn(restored, addr, biterr);
+            if (biterr != 0) {
+                uint nibble;
+                if ((errs++ < 10) && (flags & FLAG_DEBUG))
+                    printf("err=%08x at %06x\n", biterr, addr);
+                socket_fails_record(bank, biterr);
+                results_block_record(addr);
+                for (nibble = 0; nibble < 8; nibble++) {
+                    if (biterr & 0xf)
+                        bad_chips[bank][nibble] = 1;
+                    biterr >>= 4;
+                }
+                goterr++;
+            }
+            if ((addr & 0x1ffff) == 0) {
+                uint nibble;
+                if (!(flags & FLAG_SUMMARY)) {
+                    printf("%c", goterr ? 'X' : '.');
+                    fflush(stdout);
+                }
+
+                /* Quit early if all nibbles in this bank are bad */
+                if (goterr) {
+                    for (nibble = 0; nibble < 8; nibble++)
+                        if (bad_chips[bank][nibble] == 0)
+                            break;
+                    if (nibble == 8)
+                        break;
+                }
+                goterr = 0;
+            }
+        }
+        CACHE_RESTORE_STATE();
+        dma_quiet_exit(dmacon);
+        if (!(flags & FLAG_SUMMARY)) {
+            if (addr >= end)
+                printf("]");
+            if (bank_ticks != 0) {
+                printf(" %u KB/sec",
+                       kb_per_sec(bank_bytes, bank_ticks, etimer_freq));
+            }
+            printf("\n");
+        }
+        bytes_total += bank_bytes;
+        ticks_total += bank_ticks;
+    }
+    if ((ticks_total != 0) && !(flags & FLAG_SUMMARY)) {
+        printf("  Ramsey $%02x throughput: %u KB/sec\n",
+               ncontrol, kb_per_sec(bytes_total, ticks_total, etimer_freq));
+    }
+    if (!(flags & FLAG_SUMMARY)) {
+        printf("\n");
+        show_cell_results(bad_chips, flags);
+    }
+
+cleanup:
+    if (patbuf != NULL)
+        FreeMem(patbuf, patlen);
+    if (save_data != NULL)
+        FreeMem(save_data, TESTBLOCK_SIZE);
+    return (errs);
+}
+
+#define TUNE_BLOCKS         4   /* Blocks tested per bank at each setting */
+#define TUNE_RETENTION_MSEC 64  /* Time data must be held at each refresh */
+#define TUNE_SETTINGS       48  /* Page x Burst x Wrap x Skip x 3 refresh */
+
+/*
+ * tune_check_control() - run a short at-speed cell test on a few blocks
+ *                        of every bank with Ramsey in the specified mode
+ *
+ * Returns a bitmask of banks which had failures.
+ */
+static uint
+tune_check_control(uint8_t control, uint32_t bank_size, uint32_t *save_data,
+                   const uint32_t *patbuf, uint iters)
+{
+    uint8_t ocontrol  = get_ramsey_control();
+    uint    bad_banks = 0;
+    uint    bank;
+    uint    blk;
+
+    CACHE_ENABLE_DATA();
+    CACHE_ENABLE_BURST();
+    for (bank = 0; bank < ZIP_BANKS; bank++) {
+        for (blk = 0; blk < TUNE_BLOCKS; blk++) {
+            uint32_t addr = FASTMEM_TOP - bank_size * (bank + 1) +
+                            bank_size / TUNE_BLOCKS * blk;
+            uint32_t biterr;
+            uint32_t sum;
+            uint     restored;
+
+            SUPERVISOR_STATE_ENTER();
+            irq_disable();
+            MMU_DISABLE();
+            sum = block_checksum(ADDR32(addr), TESTBLOCK_SIZE);
+            burst_copy(save_data, (void *) ADDR32(addr), TESTBLOCK_SIZE);
+            cpu.dcache_flush();
+            RAMSEY_CONTROL_SET(control);
+            biterr = burst_pattern_check_mem(ADDR32(addr), TESTBLOCK_SIZE,
+                                             patbuf, iters, 0);
+            RAMSEY_CONTROL_SET(ocontrol);
+            cpu.dcache_flush();
+            restored = block_restore(ADDR32(addr), save_data,
+                                     TESTBLOCK_SIZE, sum);
+            MMU_RESTORE();
+            cpu.dcache_flush();
+            irq_enable();
+            SUPERVISOR_STATE_EXIT();
+
+            restore_warn(restored, addr, biterr);
+            if (biterr != 0)
+                bad_banks |= BIT(bank);
+        }
+    }
+    CACHE_RESTORE_STATE();
+    return (bad_banks);
+}
+
+/*
+ * tune_check_retention() - verify that one block of each bank holds its
+ *                          data for TUNE_RETENTION_MSEC with Ramsey at
+ *                          the refresh rate of the specified control value
+ *
+ * The wait polls the CIA timer directly.  ReadEClock() must not be used
+ * while Ramsey is at the setting under test, because timer.device data
+ * is in fast memory.  The CIA counts at the EClock rate, and 16-bit
+ * deltas are accumulated so that timer wraps are not missed.
+ *
+ * Returns a bitmask of banks which had failures.
+ */
+static uint
+tune_check_retention(uint8_t control, uint32_t bank_size, uint32_t *save_data,
+                     const uint32_t *patbuf)
+{
+    uint8_t  ocontrol  = get_ramsey_control();
+    uint     bad_banks = 0;
+    uint     bank;
+    uint     pos;
+    uint     cia_last;
+    uint     cia_now;
+    ULONG    freq;
+    uint32_t wait_ticks;
+    uint32_t waited;
+    struct EClockVal eclk;
+
+    freq = ReadEClock(&eclk);
+    wait_ticks = freq / 1000 * TUNE_RETENTION_MSEC;
+
+    CACHE_DISABLE_DATA();
+    for (bank = 0; bank < ZIP_BANKS; bank++) {
+        uint32_t           addr   = FASTMEM_TOP - bank_size * bank -
+                                    TESTBLOCK_SIZE;
+        volatile uint32_t *taddr  = ADDR32(addr);
+        uint32_t           biterr = 0;
+        uint32_t           sum;
+        uint               restored;
+
+        SUPERVISOR_STATE_ENTER();
+        irq_disable();
+        MMU_DISABLE();
+        sum = block_checksum(taddr, TESTBLOCK_SIZE);
+        burst_copy(save_data, (void *) taddr, TESTBLOCK_SIZE);
+        RAMSEY_CONTROL_SET(control);
+        burst_copy((void *) taddr, (void *) patbuf, TESTBLOCK_SIZE);
+        cia_last = cia_ticks();
+        for (waited = 0; waited < wait_ticks; cia_last = cia_now) {
+            cia_now = cia_ticks();
+            waited += (uint16_t) (cia_last - cia_now);  /* Counts down */
+        }
+        for (pos = 0; pos < TESTBLOCK_SIZE / 4; pos++)
+            biterr |= taddr[pos] ^ patbuf[pos];
+        RAMSEY_CONTROL_SET(ocontrol);
+        restored = block_restore(taddr, save_data, TESTBLOCK_SIZE, sum);
+        MMU_RESTORE();
+        cpu.dcache_flush();
+        irq_enable();
+        SUPERVISOR_STATE_EXIT();
+
+        restore_warn(restored, addr, biterr);
+        if (biterr != 0)
+            bad_banks |= BIT(bank);
+    }
+    CACHE_RESTORE_STATE();
+    return (bad_banks);
+}
+
+/*
+ * tune_read_kbps() - measure read bandwidth with the specified Ramsey
+ *                    control value, using the sc_memory_speed() kernel
+ */
+static uint32_t
+tune_read_kbps(uint8_t control)
+{
+    uint32_t xsize = 1 << 17;
+    uint32_t usec;
+    uint32_t usec_min = 0xffffffff;
+    uint     pass;
+
+    CACHE_ENABLE_DATA();
+    CACHE_ENABLE_BURST();
+    for (pass = 0; pass < 2; pass++) {
+        usec = memory_control_read_usec(control, 0x07c00000, xsize);
+        if (usec_min > usec)
+            usec_min = usec;
+    }
+    CACHE_RESTORE_STATE();
+    return (xsize * 1000 / usec_min);
+}
+
+/*
+ * ramsey_tune() - find the fastest stable Ramsey configuration
+ *
+ * Every combination of Page, Burst, Wrap, Skip (Ramsey-07 only) and
+ * refresh rate 00, 01, and 10 is measured for read bandwidth and checked
+ * for stability with a short at-speed cell test in every bank.  Each
+ * refresh rate is additionally checked for data retention.  The fastest
+ * stable setting is then recommended.  Ramsey is only left in each
+ * setting for the duration of the measurement; the original setting is
+ * always restored.
+ */
+static void
+ramsey_tune(uint32_t bank_size, uint flags)
+{
+    static uint8_t  tune_control[TUNE_SETTINGS];
+    static uint32_t tune_kbps[TUNE_SETTINGS];
+    static uint8_t  tune_bad[TUNE_SETTINGS];
+    uint8_t   ocontrol  = get_ramsey_control();
+    uint8_t   modebits  = RAMSEY_CONTROL_PAGE | RAMSEY_CONTROL_BURST |
+                          RAMSEY_CONTROL_WRAP;
+    uint8_t   base;
+    uint      iters     = 4;
+    uint      nmodes    = 8;
+    uint      count     = 0;
+    uint      best      = TUNE_SETTINGS;
+    uint      nearest   = TUNE_SETTINGS;
+    uint      mode;
+    uint      refresh;
+    uint      cur;
+    uint      pos;
+    uint32_t  cur_kbps;
+    uint32_t  patlen    = TESTBLOCK_SIZE + iters * sizeof (uint32_t);
+    uint32_t *save_data = NULL;
+    uint32_t *patbuf    = NULL;
+
+    printf("Ramsey tune\n");
+    if (ramsey_version == 0x7f) {
+        printf("Ramsey-01 does not support Page or Burst mode\n");
+        return;
+    }
+    if (ramsey_rev == 7) {
+        modebits |= RAMSEY_CONTROL_SKIP;
+        nmodes = 16;
+    }
+    base = ocontrol & ~(modebits | RAMSEY_CONTROL_REFRESH0 |
+                        RAMSEY_CONTROL_REFRESH1);
+
+    save_data = AllocMem(TESTBLOCK_SIZE, MEMF_PUBLIC | MEMF_CHIP);
+    patbuf    = AllocMem(patlen, MEMF_PUBLIC | MEMF_CHIP);
+    if ((save_data == NULL) || (patbuf == NULL)) {
+        printf("Cannot allocate chip memory for test buffer\n");
+        goto cleanup;
+    }
+    for (pos = 0; pos < patlen / sizeof (uint32_t); pos++)
+        patbuf[pos] = cell_patterns[pos % iters];
+
+    cur_kbps = tune_read_kbps(ocontrol);
+
+    printf("  Control Page Burst Wrap Skip Refresh KB/sec Result\n"
+           "  ------- ---- ----- ---- ---- ------- ------ ------\n");
+    for (refresh = 0; refresh < 3; refresh++) {
+        uint8_t rcontrol = base | (refresh << 5);
+        uint    bad_retention;
+
+        bad_retention = tune_check_retention(rcontrol, bank_size, save_data,
+                                             patbuf);
+        for (mode = 0; mode < nmodes; mode++) {
+            uint8_t control = rcontrol | (mode & 7);
+            uint    bad;
+
+            if (mode & 8)
+                control |= RAMSEY_CONTROL_SKIP;
+
+            tune_kbps[count] = tune_read_kbps(control);
+            bad = bad_retention |
+                  tune_check_control(control, bank_size, save_data,
+                                     patbuf, iters);
+            tune_control[count] = control;
+            tune_bad[count] = bad;
+
+            printf("  $%02x%c    %-4s %-5s %-4s %-4s %-7s %6u ", control,
+                   (control == ocontrol) ? '*' : ' ',
+                   (control & RAMSEY_CONTROL_PAGE) ? "Yes" : "-",
+                   (control & RAMSEY_CONTROL_BURST) ? "Yes" : "-",
+                   (control & RAMSEY_CONTROL_WRAP) ? "Yes" : "-",
+                   (mode & 8) ? "Yes" : "-",
+                   ramsey_refresh_timing[refresh].clocks, tune_kbps[count]);
+            if (bad == 0) {
+                printf("Stable\n");
+            } else {
+                printf("Fail bank");
+                for (cur = 0; cur < ZIP_BANKS; cur++)
+                    if (bad & BIT(cur))
+                        printf(" %u", cur);
+                printf("\n");
+            }
+            if ((bad == 0) && ((best == TUNE_SETTINGS) ||
+                               (tune_kbps[best] < tune_kbps[count]))) {
+                best = count;
+            }
+            count++;
+        }
+    }
+
+    if (best == TUNE_SETTINGS) {
+        printf("No stable setting found\n");
+        goto cleanup;
+    }
+
+    /* Nearest faster setting which failed determines the margin */
+    for (cur = 0; cur < count; cur++) {
+        if ((tune_bad[cur] != 0) && (tune_kbps[cur] > tune_kbps[best]) &&
+            ((nearest == TUNE_SETTINGS) ||
+             (tune_kbps[cur] < tune_kbps[nearest]))) {
+            nearest = cur;
+        }
+    }
+
+    printf("\n  Current:     $%02x %u KB/sec\n", ocontrol, cur_kbps);
+    printf("  Recommended: $%02x %u KB/sec", tune_control[best],
+           tune_kbps[best]);
+    if (tune_kbps[best] > cur_kbps) {
+        uint32_t pct_x_10 = (tune_kbps[best] - cur_kbps) * 1000 / cur_kbps;
+        printf(" (%u.%u%% faster)", pct_x_10 / 10, pct_x_10 % 10);
+    }
+    printf("\n  Margin:      ");
+    if (nearest == TUNE_SETTINGS) {
+        printf("no faster setting failed\n");
+    } else {
+        uint32_t pct_x_10 = (tune_kbps[nearest] - tune_kbps[best]) * 1000 /
+                            tune_kbps[best];
+        printf("next faster setting $%02x (+%u.%u%%) failed\n",
+               tune_control[nearest], pct_x_10 / 10, pct_x_10 % 10);
+    }
+    if (flags & FLAG_DEBUG)
+        printf("  %u settings tested\n", count);
+
+cleanup:
+    if (patbuf != NULL)
+        FreeMem(patbuf, patlen);
+    if (save_data != NULL)
+        FreeMem(save_data, TESTBLOCK_SIZE);
+}
+
+/*
+ * BENCH
+ * -----
+ * Memory benchmark matrix.  Every kernel is timed at each block size in
+ * each bank, with every Ramsey Page / Burst / Skip combination and every
+ * CPU data cache and burst state.  Each measurement moves BENCH_BYTES
+ * (the kernel is repeated over the block), and is repeated the requested
+ * number of times.  Results are written as CSV so that runs on different
+ * machines and CPU cards can be compared.
+ */
+#define BENCH_BYTES      (128 << 10)  /* Bytes moved per measurement */
+#define BENCH_MAX_SIZE   (64 << 10)   /* Largest block size */
+#define BENCH_MAX_REPS   15
+#define BENCH_DCACHE     BIT(0)       /* Cache state: data cache on */
+#define BENCH_CPU_BURST  BIT(1)       /* Cache state: CPU burst on */
+
+static const uint32_t bench_sizes[] = { 4 << 10, 16 << 10, BENCH_MAX_SIZE };
+
+static void
+bench_copy(volatile void *addr, uint len)
+{
+    burst_copy((uint8_t *) addr + len / 2, addr, len / 2);
+}
+
+static void
+bench_copy_move16(volatile void *addr, uint len)
+{
+    bench_move16((uint8_t *) addr + len / 2, addr, len / 2);
+}
+
+static const struct {
+    const char *name;
+    void       (*func)(volatile void *addr, uint len);
+    uint8_t    writes;   /* Kernel modifies memory */
+    uint8_t    need040;  /* Kernel requires 68040 or 68060 */
+} bench_kernels[] = {
+    { "read.l", burst_read_readl,  0, 0 },
+    { "movem",  burst_read_moveml, 0, 0 },
+    { "write",  bench_write,       1, 0 },
+    { "copy",   bench_copy,        1, 0 },
+    { "rmw",    bench_rmw,         1, 0 },
+    { "move16", bench_copy_move16, 1, 1 },
+};
+
+/*
+ * bench_usec() - time one kernel over the block at addr, with Ramsey
+ *                temporarily set to the specified control value.  The
+ *                block is saved before and restored after the kernel
+ *                runs.  Returns elapsed microseconds, or 0 if the block
+ *                did not restore correctly.
+ */
+static uint32_t
+bench_usec(uint kernel, uint8_t control, uint32_t addr, uint32_t size,
+           uint32_t *save_data)
+{
+    uint8_t  ocontrol = get_ramsey_control();
+    uint     writes   = bench_kernels[kernel].writes;
+    uint     loops    = BENCH_BYTES / size;
+    uint     loop;
+    uint     restored = RESTORE_OK;
+    uint16_t cia_start;
+    uint16_t cia_end;
+    uint32_t sum      = 0;
+    uint32_t usec;
+
+    SUPERVISOR_STATE_ENTER();
+    INTERRUPTS_DISABLE();
+    MMU_DISABLE();
+    if (writes) {
+        sum = block_checksum(ADDR32(addr), size);
+        burst_copy(save_data, (void *) ADDR32(addr), size);
+    }
+    cpu.dcache_flush();
+
+    /*
+     * Timed by the CIA directly rather than ReadEClock(), which may touch
+     * timer.device data in a block which still holds kernel output.
+     * BENCH_BYTES takes well under one CIA timer period.
+     */
+    cia_start = cia_ticks();
+    RAMSEY_CONTROL_SET(control);
+    for (loop = 0; loop < loops; loop++)
+        bench_kernels[kernel].func(ADDR32(addr), size);
+    if (writes)
+        cpu.dcache_flush();  // Count copyback writes to memory
+    RAMSEY_CONTROL_SET(ocontrol);
+    cia_end = cia_ticks();
+
+    if (writes)
+        restored = block_restore(ADDR32(addr), save_data, size, sum);
+    MMU_RESTORE();
+    cpu.dcache_flush();
+    INTERRUPTS_ENABLE();
+    SUPERVISOR_STATE_EXIT();
+
+    restore_warn(restored, addr, 0);
+    if (restored != RESTORE_OK)
+        return (0);
+
+    usec = etimer_usec((uint16_t) (cia_start - cia_end));  /* Counts down */
+    if (usec == 0)
+        usec = 10;
+    return (usec);
+}
+
+/*
+ * bench_matrix() - run the memory benchmark matrix, repeating each
+ *                  measurement reps times
+ */
+static int
+bench_matrix(uint32_t bank_size, uint reps, uint flags)
+{
+    static uint32_t usecs[BENCH_MAX_REPS];
+    uint8_t   ocontrol  = get_ramsey_control();
+    uint8_t   modebits  = RAMSEY_CONTROL_PAGE | RAMSEY_CONTROL_BURST;
+    uint8_t   base;
+    uint32_t  ocache    = CacheControl(0, 0) & (CACRF_EnableD | CACRF_DBE);
+    uint32_t *save_data;
+    uint      nmodes    = 4;
+    uint      rows      = 0;
+    uint      cache;
+    uint      mode;
+    uint      bank;
+    uint      kernel;
+    uint      size;
+    uint      rep;
+    uint      pos;
+    int       rc        = 0;
+
+    if (reps > BENCH_MAX_REPS)
+        reps = BENCH_MAX_REPS;
+    if (ramsey_version == 0x7f)
+        nmodes = 1;  /* Ramsey-01 does not support Page or Burst mode */
+    if (ramsey_rev == 7) {
+        modebits |= RAMSEY_CONTROL_SKIP;
+        nmodes = 8;
+    }
+    base = ocontrol & ~modebits;
+
+    save_data = AllocMem(BENCH_MAX_SIZE, MEMF_PUBLIC | MEMF_CHIP);
+    if (save_data == NULL) {
+        printf("Cannot allocate chip memory for test buffer\n");
+        return (1);
+    }
+
+    printf("cpu,ramsey,kernel,bank,address,size,control,page,burst,skip,"
+           "dcache,cpuburst,reps,best_kbps,median_kbps,worst_kbps,"
+           "spread_pct\n");
+    for (cache = 0; cache < 4; cache++) {
+        CacheControl(((cache & BENCH_DCACHE) ? CACRF_EnableD : 0) |
+                     ((cache & BENCH_CPU_BURST) ? CACRF_DBE : 0),
+                     CACRF_EnableD | CACRF_DBE);
+        for (mode = 0; mode < nmodes; mode++) {
+            uint8_t control = base | (mode & 3);
+
+            if (mode & 4)
+                control |= RAMSEY_CONTROL_SKIP;
+            for (bank = 0; bank < ZIP_BANKS; bank++) {
+                uint32_t addr = FASTMEM_TOP - bank_size * (bank + 1);
+
+                for (kernel = 0; kernel < ARRAY_SIZE(bench_kernels);
+                     kernel++) {
+                    if (bench_kernels[kernel].need040 && (cpu_type < 68040))
+                        continue;
+                    for (size = 0; size < ARRAY_SIZE(bench_sizes); size++) {
+                        uint32_t spread;
+
+                        for (rep = 0; rep < reps; rep++) {
+                            uint32_t usec = bench_usec(kernel, control, addr,
+                                                       bench_sizes[size],
+                                                       save_data);
+                            if (usec == 0) {
+                                rc = 1;
+                                goto done;
+                            }
+                            /* Insertion sort */
+                            for (pos = rep; pos > 0; pos--) {
+                                if (usecs[pos - 1] <= usec)
+                                    break;
+                                usecs[pos] = usecs[pos - 1];
+                            }
+                            usecs[pos] = usec;
+                        }
+                        spread = (usecs[reps - 1] - usecs[0]) * 1000 /
+                                 usecs[0];
+                        printf("%u,%u,%s,%u,%08x,%u,%02x,%u,%u,%u,%u,%u,%u,"
+                               "%u,%u,%u,%u.%u\n", cpu_type, ramsey_rev,
+                               bench_kernels[kernel].name, bank, addr,
+                               bench_sizes[size], control,
+                               !!(control & RAMSEY_CONTROL_PAGE),
+                               !!(control & RAMSEY_CONTROL_BURST),
+                               !!(mode & 4), !!(cache & BENCH_DCACHE),
+                               !!(cache & BENCH_CPU_BURST), reps,
+                               BENCH_BYTES * 1000 / usecs[0],
+                               BENCH_BYTES * 1000 / usecs[reps / 2],
+                               BENCH_BYTES * 1000 / usecs[reps - 1],
+                               spread / 10, spread % 10);
+                        rows++;
+                    }
+                    if (SetSignal(0, 0) & SIGBREAKF_CTRL_C) {
+                        SetSignal(0, SIGBREAKF_CTRL_C);
+                        printf("^C\n");
+                        goto done;
+                    }
+                }
             }
         }
-        *ADDR8(AMIGA_PPORT_DATA) = 0x00;
-        MMU_RESTORE();
-        INTERRUPTS_ENABLE();
-        SUPERVISOR_STATE_EXIT();
-        CACHE_RESTORE_STATE();
     }
+done:
+    CacheControl(ocache, CACRF_EnableD | CACRF_DBE);
+    FreeMem(save_data, BENCH_MAX_SIZE);
+    if (flags & FLAG_DEBUG)
+        printf("%u rows\n", rows);
+    return (rc);
 }
 
-/* Test patterns (must be a prime number of patterns) */
-static const uint32_t cell_patterns[] = {
-    0xaaaaaaaa, 0x55555555, 0xcccccccc, 0x33333333,
-    0x11111111, 0x22222222, 0x44444444, 0x88888888,
-    0x77777777, 0xeeeeeeee, 0xdddddddd, 0xbbbbbbbb,
-    0x00000000
-};
+/*
+ * LATENCY
+ * -------
+ * Dependent-load latency benchmark.  A chain is built in ZIP memory where
+ * each long holds the offset of the next from the bottom of ZIP memory,
+ * so every read must complete before the next can start.  Addresses are
+ * chosen with amask_to_address() so that consecutive reads stay in the
+ * same DRAM row (page hit), move to a new row of the same bank (page
+ * miss), or move to a different bank.  The data cache is off for the
+ * measurement.
+ *
+ * Page and Burst modes return stale data from Fast Page Mode (non-SC)
+ * memory.  latency_chase() masks every offset it reads, so a bad value
+ * can only lead to another read of ZIP memory.  A chain which does not
+ * end where expected is reported as unreliable rather than timed.
+ */
+#define LAT_NODES     64     /* Pointers in each chain */
+#define LAT_LOADS     4096   /* Loads per timed pass (multiple of 16) */
+#define LAT_PASSES    5      /* Best of this many passes is reported */
+#define LAT_HIT       0
+#define LAT_MISS      1
+#define LAT_BANK      2
+#define LAT_PATTERNS  3
+
+static uint32_t lat_addr[LAT_NODES];
+static uint32_t lat_save[LAT_NODES];
+static uint32_t lat_base;  /* Bottom of ZIP memory */
+static uint32_t lat_mask;  /* Offsets of all longs in ZIP memory */
 
 /*
- * pattern_check_mem() - run a pattern test on the specified memory range
+ * latency_chain_build() - compute the node addresses of a chain which
+ *                         follows the specified access pattern
  */
-static uint32_t
-pattern_check_mem(volatile uint32_t *addr, size_t size, uint flags)
+static void
+latency_chain_build(uint pattern, uint addrbits)
 {
-    volatile uint32_t *taddr;
-    uint32_t           biterr = 0;
-    uint               pat;
-    size_t             count;
-    uint               iters = ARRAY_SIZE(cell_patterns);
-    uint               iter;
-
-    if (!(flags & FLAG_LONG_TEST))
-        iters = 2;
-    for (iter = 0; iter < iters; iter++) {
-        /* Write pattern set */
-        pat   = iter;
-        taddr = addr;
-        count = size / 4;
-        while (count-- > 0) {
-            *taddr = cell_patterns[pat];
-            if (++pat == iters)
-                pat = 0;
-            taddr++;
+    uint     casbits = addrbits / 2;
+    uint32_t mask    = BIT(casbits) - 1;
+    uint32_t zip_len = BIT(addrbits) * 4 * ZIP_BANKS;
+    uint     node;
+
+    lat_base = FASTMEM_TOP - zip_len;
+    lat_mask = (zip_len - 1) & ~3;
+    for (node = 0; node < LAT_NODES; node++) {
+        uint32_t step = (node * 7 + 1) & mask;  /* Distinct for all nodes */
+        uint     bank = 0;
+        uint32_t ras  = 0x55 & mask;
+        uint32_t cas  = step;
+
+        switch (pattern) {
+            case LAT_MISS:
+                ras = step;
+                cas = 0x55 & mask;
+                break;
+            case LAT_BANK:
+                bank = node % ZIP_BANKS;
+                break;
         }
+        lat_addr[node] = amask_to_address(bank, cas | (ras << casbits),
+                                          addrbits);
+    }
+}
 
-        cpu_dcache_flush();
+/*
+ * latency_chain_ticks() - time LAT_LOADS dependent loads around the chain
+ *                         in lat_addr[] with Ramsey temporarily set to the
+ *                         specified control value.  Returns the best
+ *                         CIA tick count of LAT_PASSES passes, or 0 if
+ *                         the chain did not read back correctly.
+ */
+static uint
+latency_chain_ticks(uint8_t control)
+{
+    uint8_t  ocontrol = get_ramsey_control();
+    uint16_t start;
+    uint16_t end;
+    uint16_t calltime;
+    uint16_t ticks;
+    uint16_t best     = 0xffff;
+    uint32_t first    = lat_addr[0] - lat_base;
+    uint32_t last;
+    uint     broken   = 0;
+    uint     node;
+    uint     pass;
 
-        /* Verify pattern set */
-        pat   = iter;
-        taddr = addr;
-        count = size / 4;
-        while (count-- > 0) {
-            biterr |= (*taddr ^ cell_patterns[pat]);
-            if (++pat == iters)
-                pat = 0;
-            taddr++;
+    CACHE_DISABLE_DATA();
+    SUPERVISOR_STATE_ENTER();
+    INTERRUPTS_DISABLE();
+    MMU_DISABLE();
+    for (node = 0; node < LAT_NODES; node++)
+        lat_save[node] = *ADDR32(lat_addr[node]);
+    for (node = 0; node < LAT_NODES; node++)
+        *ADDR32(lat_addr[node]) = lat_addr[(node + 1) % LAT_NODES] -
+                                  lat_base;
+    RAMSEY_CONTROL_SET(control);
+
+    start    = cia_ticks();  // force code into cache
+    start    = cia_ticks();
+    end      = cia_ticks();
+    calltime = start - end;
+    for (pass = 0; pass < LAT_PASSES; pass++) {
+        start = cia_ticks();
+        last  = latency_chase(ADDR32(lat_base), first, LAT_LOADS, lat_mask);
+        end   = cia_ticks();
+        ticks = start - end - calltime;  // CIA timer counts down
+        if (best > ticks)
+            best = ticks;
+        if (last != lat_addr[LAT_LOADS % LAT_NODES] - lat_base)
+            broken = 1;
+    }
+
+    RAMSEY_CONTROL_SET(ocontrol);
+    for (node = LAT_NODES; node > 0; node--)
+        *ADDR32(lat_addr[node - 1]) = lat_save[node - 1];
+    MMU_RESTORE();
+    INTERRUPTS_ENABLE();
+    SUPERVISOR_STATE_EXIT();
+    CACHE_RESTORE_STATE();
+    return (broken ? 0 : best);
+}
+
+/*
+ * latency_test() - report nanoseconds per dependent load for page hits,
+ *                  page misses, and bank switches in each Ramsey mode
+ */
+static void
+latency_test(uint addrbits, uint flags)
+{
+    static uint32_t ns_x10[LAT_PATTERNS];
+    uint8_t  ocontrol = get_ramsey_control();
+    uint8_t  modebits = RAMSEY_CONTROL_PAGE | RAMSEY_CONTROL_BURST;
+    uint8_t  base;
+    uint     nmodes   = 4;
+    uint     mode;
+    uint     pattern;
+    uint     bad      = 0;
+    uint32_t tick_ps10;  /* Tenths of a nanosecond per CIA tick */
+    struct EClockVal eclk;
+
+    tick_ps10 = 1000000000 / (ReadEClock(&eclk) / 10);
+    if (ramsey_version == 0x7f)
+        nmodes = 1;  /* Ramsey-01 does not support Page or Burst mode */
+    if (ramsey_rev == 7) {
+        modebits |= RAMSEY_CONTROL_SKIP;
+        nmodes = 8;
+    }
+    base = ocontrol & ~modebits;
+
+    printf("Load latency (ns, data cache off)\n"
+           "  Control Page Burst Skip  Page hit Page miss Bank switch\n"
+           "  ------- ---- ----- ---- --------- --------- -----------\n");
+    for (mode = 0; mode < nmodes; mode++) {
+        uint8_t control = base | (mode & 3);
+
+        if (mode & 4)
+            control |= RAMSEY_CONTROL_SKIP;
+        for (pattern = 0; pattern < LAT_PATTERNS; pattern++) {
+            uint ticks;
+
+            latency_chain_build(pattern, addrbits);
+            ticks = latency_chain_ticks(control);
+            ns_x10[pattern] = ticks * tick_ps10 / LAT_LOADS;
+            if (flags & FLAG_DEBUG)
+                printf("  pattern %u ticks=%u\n", pattern, ticks);
+        }
+        printf("  $%02x%c    %-4s %-5s %-4s", control,
+               (control == ocontrol) ? '*' : ' ',
+               (control & RAMSEY_CONTROL_PAGE) ? "Yes" : "-",
+               (control & RAMSEY_CONTROL_BURST) ? "Yes" : "-",
+               (mode & 4) ? "Yes" : "-");
+        for (pattern = 0; pattern < LAT_PATTERNS; pattern++) {
+            uint width = (pattern == LAT_BANK) ? 9 : 7;
+
+            if (ns_x10[pattern] == 0) {
+                printf(" %*s", width + 2, "bad");  /* Stale reads */
+                bad = 1;
+            } else {
+                printf(" %*u.%u", width, ns_x10[pattern] / 10,
+                       ns_x10[pattern] % 10);
+            }
         }
+        printf("\n");
+    }
+    if (bad) {
+        printf("  bad: the chain read back wrong, as expected in Page or "
+               "Burst mode\n       without Static Column RAM\n");
     }
-    return (biterr);
 }
 
 /*
- * cell_data_test() - test all ZIP package memory cells
+ * Interleave test block size.  The test works on this size block at the
+ * same offset in two rows of every bank at once (8 blocks in total).
+ */
+#define INTERLEAVE_BLOCK_SIZE 1024
+#define INTERLEAVE_BLOCKS     (ZIP_BANKS * 2)
+
+/*
+ * interleave_test() - bank-interleaved precharge stress test
  *
- * Algoritm:
- * 1) Allocate 4k buffer in chip memory
- * 2) Walk all banks:
- * 3) Disable interrupts
- * 4) Walk all memory blocks..
- * 5) Walk list of memory cell test patterns, writing different pattern to
- *    each consecutive memory location.
- * 6) Flush cache
- * 7) Verify list of patterns against memory locations
- * 8) Execute above repeatedly, using each pattern as a new starting point
- * 9) Enable interrupts
+ * Walks block offsets through the lower half of each bank.  At each
+ * offset, the block in the lower half (row A) and the block at the same
+ * offset in the upper half (row B) of every bank are saved, tested by
+ * interleave_check() in util.asm, and restored.  Memory which passes the
+ * linear cell test but has marginal RAS precharge or refresh arbitration
+ * timing will fail here.  The achieved access rate is reported.
  */
 static int
-cell_data_test(uint32_t bank_size, uint flags)
+interleave_test(uint32_t bank_size, uint flags)
 {
-    int       errs = 0;
-    uint      pos;
+    int       errs        = 0;
     uint      bank;
-    uint32_t *save_data = AllocMem(TESTBLOCK_SIZE, MEMF_PUBLIC | MEMF_CHIP);
-    uint32_t *diffs     = AllocMem(TESTBLOCK_SIZE, MEMF_PUBLIC | MEMF_CHIP);
+    uint      blk;
+    uint      goterr      = 0;
+    uint      iter;
+    uint      iters       = ARRAY_SIZE(cell_patterns);
+    uint32_t  offset      = 0;
+    uint32_t  half        = bank_size / 2;
+    uint32_t  ticks_total = 0;
+    uint16_t  cia_start;
+    uint16_t  cia_end;
+    uint32_t  accesses    = 0;
+    uint32_t  apms;
+    uint32_t  msec;
+    uint32_t *save_data;
     uint8_t   bad_chips[ZIP_BANKS][8];  /* [banks][nibbles] */
+    uint16_t  dmacon;
+    uint32_t  ticks;
+    etimer_t  timer;
+    volatile uint32_t *blocks[INTERLEAVE_BLOCKS];
 
-    printf("Memory cell test\n");
+    if (!(flags & FLAG_SUMMARY))
+        printf("Bank interleave test\n");
     memset(bad_chips, 0, sizeof (bad_chips));
 
-    if ((save_data == NULL) || (diffs == NULL)) {
+    save_data = AllocMem(INTERLEAVE_BLOCK_SIZE * INTERLEAVE_BLOCKS,
+                         MEMF_PUBLIC | MEMF_CHIP);
+    if (save_data == NULL) {
         printf("Cannot allocate chip memory for test buffer\n");
-        goto cleanup;
+        return (0);
     }
+    if (!(flags & FLAG_LONG_TEST))
+        iters = 2;
 
-    memset(diffs, 0, TESTBLOCK_SIZE);
+    if (!(flags & FLAG_SUMMARY)) {
+        printf("  Banks 0-%u [%*s]\r  Banks 0-%u [",
+               ZIP_BANKS - 1, half / 0x20000, "", ZIP_BANKS - 1);
+    }
 
-    /* Perform test */
-    for (bank = 0; bank < ZIP_BANKS; bank++) {
-        uint32_t start  = FASTMEM_TOP - bank_size * (bank + 1);
-        uint32_t end    = FASTMEM_TOP - bank_size * bank;
-        uint32_t addr   = start;
-        uint     goterr = 0;
+    dmacon = dma_quiet_enter(flags);
+    CACHE_DISABLE_DATA();
+    for (offset = 0; offset < half; offset += INTERLEAVE_BLOCK_SIZE) {
+        uint32_t bank_biterr[ZIP_BANKS];
+        uint32_t sum[INTERLEAVE_BLOCKS];
+        uint     restored[INTERLEAVE_BLOCKS];
 
-        if (flags & FLAG_DEBUG)
-            printf("\nstart=%x end=%x\n", start, end);
-        printf("  Bank %u [%*s]\r  Bank %u [",
-               bank, bank_size / 0x20000, "", bank);
+        for (bank = 0; bank < ZIP_BANKS; bank++) {
+            uint32_t start = FASTMEM_TOP - bank_size * (bank + 1) + offset;
+            blocks[bank]             = ADDR32(start);
+            blocks[bank + ZIP_BANKS] = ADDR32(start + half);
+            bank_biterr[bank] = 0;
+        }
 
-        CACHE_DISABLE_DATA();
-        for (addr = start; addr < end; addr += TESTBLOCK_SIZE) {
-            uint32_t biterr;
+        /* Cache and interrupts are disabled in this block */
+        SUPERVISOR_STATE_ENTER();
+        irq_disable();
+        MMU_DISABLE();
+        etimer_start(&timer);
+        for (blk = 0; blk < INTERLEAVE_BLOCKS; blk++) {
+            sum[blk] = block_checksum(blocks[blk], INTERLEAVE_BLOCK_SIZE);
+            burst_copy(save_data + blk * INTERLEAVE_BLOCK_SIZE / 4,
+                       blocks[blk], INTERLEAVE_BLOCK_SIZE);
+        }
 
-            /* Cache and interrupts are disabled in this block */
-            SUPERVISOR_STATE_ENTER();
-//          INTERRUPTS_DISABLE();
-            irq_disable();
-            MMU_DISABLE();
-            burst_copy(save_data, (void *) ADDR32(addr), TESTBLOCK_SIZE);
-            biterr = pattern_check_mem(ADDR32(addr), 2048, flags);
-            burst_copy((void *) ADDR32(addr), save_data, TESTBLOCK_SIZE);
-            cpu_dcache_flush();
-            MMU_RESTORE();
-            cpu_dcache_flush();
-            irq_enable();
-//          INTERRUPTS_ENABLE();
-            SUPERVISOR_STATE_EXIT();
+        /*
+         * The kernel is timed by the CIA directly, as ReadEClock() may
+         * touch timer.device data in the ZIP blocks under test.  Even
+         * with LONG, it takes well under one CIA timer period.
+         */
+        cia_start = cia_ticks();
+        for (iter = 0; iter < iters; iter++) {
+            interleave_check(blocks, cell_patterns[iter],
+                             INTERLEAVE_BLOCK_SIZE, bank_biterr);
+        }
+        cia_end = cia_ticks();
+        for (blk = 0; blk < INTERLEAVE_BLOCKS; blk++) {
+            restored[blk] = block_restore(blocks[blk],
+                                save_data + blk * INTERLEAVE_BLOCK_SIZE / 4,
+                                INTERLEAVE_BLOCK_SIZE, sum[blk]);
+        }
+        ticks = etimer_lap(&timer);
+        MMU_RESTORE();
+        cpu.dcache_flush();
+        irq_enable();
+        SUPERVISOR_STATE_EXIT();
 
-            if (biterr != 0) {
-                uint nibble;
-                if ((errs++ < 10) && (flags & FLAG_DEBUG))
-                    printf("err=%08x at %06x\n", biterr, addr);
-                for (nibble = 0; nibble < 8; nibble++) {
-                    if (biterr & 0xf)
-                        bad_chips[bank][nibble] = 1;
-                    biterr >>= 4;
-                }
-                goterr++;
+        ticks_total += (uint16_t) (cia_start - cia_end);  /* Counts down */
+        accesses    += INTERLEAVE_BLOCK_SIZE / 4 * INTERLEAVE_BLOCKS * 2 *
+                       iters;
+        timing_irqoff(0, ticks, INTERLEAVE_BLOCK_SIZE * INTERLEAVE_BLOCKS *
+                                (4 + 2 * iters));
+
+        for (blk = 0; blk < INTERLEAVE_BLOCKS; blk++) {
+            restore_warn(restored[blk], (uint32_t) blocks[blk],
+                         bank_biterr[blk % ZIP_BANKS]);
+        }
+        for (bank = 0; bank < ZIP_BANKS; bank++) {
+            uint32_t biterr = bank_biterr[bank];
+            uint     nibble;
+
+            if (biterr == 0)
+                continue;
+            if ((errs++ < 10) && (flags & FLAG_DEBUG)) {
+                printf("err=%08x at bank %u offset %06x\n",
+                       biterr, bank, offset);
             }
-            if ((addr & 0x1ffff) == 0) {
-                uint nibble;
-//              printf("[%04x %04x %04x]", tval1, tval2, tval3);
+            socket_fails_record(bank, biterr);
+            for (nibble = 0; nibble < 8; nibble++) {
+                if (biterr & 0xf)
+                    bad_chips[bank][nibble] = 1;
+                biterr >>= 4;
+            }
+            goterr++;
+        }
+        if (((offset + INTERLEAVE_BLOCK_SIZE) & 0x1ffff) == 0) {
+            if (!(flags & FLAG_SUMMARY)) {
                 printf("%c", goterr ? 'X' : '.');
                 fflush(stdout);
-
-                /* Quit early if all nibbles in this bank are bad */
-                if (goterr) {
-                    for (nibble = 0; nibble < 8; nibble++)
-                        if (bad_chips[bank][nibble] == 0)
-                            break;
-                    if (nibble == 8)
-                        break;
-                }
-                goterr = 0;
             }
+            goterr = 0;
         }
-        CACHE_RESTORE_STATE();
-        if (addr >= end)
-            printf("]");
-        printf("\n");
     }
-    printf("\n");
-
-    /* Display results */
-    printf("  Socket   Result   Socket   Result\n"
-           "  -------- ------   -------- ------\n");
-    for (pos = 0; pos < ARRAY_SIZE(zip_u_data); pos++) {
-        uint nibble = zip_u_data[pos].nibble;
-        bank = zip_u_data[pos].bank;
-        printf("  %s %u.%u %-4s", zip_u_data[pos].skt, zip_u_data[pos].bank,
-               nibble, bad_chips[bank][nibble] ? "!" : "Good");
-        if (zip_u_data[pos].position == POS_RIGHT)
-            printf("\n");
-        else
-            printf("   ");
+    CACHE_RESTORE_STATE();
+    dma_quiet_exit(dmacon);
+    if (flags & FLAG_SUMMARY)
+        goto cleanup;
+    printf("]\n");
+
+    if (ticks_total != 0) {
+        msec = ticks_total / (etimer_freq / 1000);
+        if (msec == 0)
+            msec = 1;
+        apms = accesses / msec;  /* Accesses per msec = K accesses/sec */
+        printf("  Access rate: %u.%03u M accesses/sec\n",
+               apms / 1000, apms % 1000);
     }
+    printf("\n");
 
-    if (flags & FLAG_SHOW_DIP) {
-        int nibble;
-        bank = dip_u_data[0].bank;
-        show_dip_header();
-        printf("     ");
-        for (nibble = 7; nibble >= 0; nibble--)
-            printf(" %-5s", bad_chips[bank][nibble] ? "!" : "Good");
-        printf("\n");
-    }
+    show_cell_results(bad_chips, flags);
 
 cleanup:
-    if (diffs != NULL)
-        FreeMem(diffs, TESTBLOCK_SIZE);
-    if (save_data != NULL)
-        FreeMem(save_data, TESTBLOCK_SIZE);
+    FreeMem(save_data, INTERLEAVE_BLOCK_SIZE * INTERLEAVE_BLOCKS);
     return (errs);
 }
 
@@ -2244,17 +6608,11 @@ mmu_open(void)
 {
     uint32_t tc;
 
-    if (cpu_type == 68030) {
-        SUPERVISOR_STATE_ENTER();
-        tc = mmu_get_tc_030();              // pmove.l tc,(sp)
-        SUPERVISOR_STATE_EXIT();
-        mmu_is_active = !!(tc & BIT(31));
-    }
-    if ((cpu_type == 68040) || (cpu_type == 68060)) {
+    if (cpu.mmu_enable != 0) {
         SUPERVISOR_STATE_ENTER();
-        tc = mmu_get_tc_040();              // movec.l tc,d0
+        tc = cpu.mmu_get_tc();
         SUPERVISOR_STATE_EXIT();
-        mmu_is_active = !!(tc & BIT(15));
+        mmu_is_active = !!(tc & cpu.mmu_enable);
     }
 }
 
@@ -2270,6 +6628,7 @@ c_main(int argc, char **argv)
     uint8_t  mem_width;           /* Bits per ZIP IC: 1 or 4 (4 is expected) */
     uint     mem_addrbits;        /* ZIP memory bits (20 or 18) */
     uint     ramsey_khz;
+    uint     ramsey_khz_err;
     int      arg;
     int      rc2;
     int      rc             = 0;
@@ -2284,6 +6643,24 @@ c_main(int argc, char **argv)
     int      flag_quiet     = 0;  /* Don't display banner */
     int      flag_strobe    = 0;  /* Generate address strobes for logic probe */
     int      flag_sprobe    = 0;  /* Probe for static column memory */
+    int      flag_burst     = 0;  /* Memory cell test in Page + Burst mode */
+    int      flag_ileave    = 0;  /* Bank-interleaved precharge stress test */
+    int      flag_tune      = 0;  /* Find fastest stable Ramsey settings */
+    int      flag_latency   = 0;  /* Measure page hit / miss latency */
+    int      flag_range     = 0;  /* Cell test of RANGE= address ranges */
+    int      flag_history   = 0;  /* Use and update failure history */
+    const char *results_file = NULL;  /* RESULTS= file to save to */
+    const char *retest_file  = NULL;  /* RETEST= file of previous results */
+    const char *watch_name   = NULL;  /* WATCH= socket to check repeatedly */
+    const char *strobe_file  = NULL;  /* STROBE= script of accesses */
+    uint     loop;
+    uint     loop_count     = 0;  /* LOOP=n iterations (0 = no limit) */
+    uint     loop_secs      = 0;  /* TIME=s seconds (0 = no limit) */
+    uint     bench_reps     = 0;  /* BENCH=n repetitions per measurement */
+    int      looping;
+    uint     tflags;              /* flags for the current iteration */
+    const char *value;
+    struct DateStamp loop_start;
 
     for (arg = 1; arg < argc; arg++) {
         if (stricmp(argv[arg], "ADDR") == 0) {
@@ -2291,6 +6668,10 @@ c_main(int argc, char **argv)
         } else if (stricmp(argv[arg], "ASCII") == 0) {
             show_ascii_art();
             return (0);
+        } else if (stricmp(argv[arg], "BURST") == 0) {
+            flag_burst = 1;
+        } else if (stricmp(argv[arg], "CACHEON") == 0) {
+            flags |= FLAG_CACHE_ON;
         } else if (stricmp(argv[arg], "CELL") == 0) {
             flag_cell_test = 1;
         } else if (stricmp(argv[arg], "DATA") == 0) {
@@ -2302,47 +6683,128 @@ c_main(int argc, char **argv)
                 flags |= FLAG_DEBUG;
         } else if (stricmp(argv[arg], "DIP") == 0) {
             flags |= FLAG_SHOW_DIP;
+        } else if (stricmp(argv[arg], "FAILFAST") == 0) {
+            flags |= FLAG_FAIL_FAST;
         } else if (stricmp(argv[arg], "FORCE") == 0) {
             flag_force = 1;
+        } else if (stricmp(argv[arg], "HISTORY") == 0) {
+            flag_history = 1;
         } else if (stricmp(argv[arg], "INFO") == 0) {
             flag_info = 1;
+        } else if (stricmp(argv[arg], "BENCH") == 0) {
+            bench_reps = 5;
+        } else if ((value = arg_value(argv[arg], "BENCH=")) != NULL) {
+            bench_reps = strtoul(value, NULL, 0);
+            if (bench_reps == 0) {
+                usage();
+                return (1);
+            }
+        } else if (stricmp(argv[arg], "ILEAVE") == 0) {
+            flag_ileave = 1;
+        } else if (stricmp(argv[arg], "LATENCY") == 0) {
+            flag_latency = 1;
         } else if (stricmp(argv[arg], "LONG") == 0) {
             flags |= FLAG_LONG_TEST;
+        } else if ((value = arg_value(argv[arg], "LOOP=")) != NULL) {
+            loop_count = strtoul(value, NULL, 0);
+            if (loop_count == 0) {
+                usage();
+                return (1);
+            }
         } else if (stricmp(argv[arg], "MAP") == 0) {
             flags |= FLAG_SHOW_MAP;
+        } else if (stricmp(argv[arg], "MARKERS") == 0) {
+            markers_enabled = 1;
         } else if (stricmp(argv[arg], "QUIET") == 0) {
             flag_quiet = 1;
+        } else if (stricmp(argv[arg], "QUIETDMA") == 0) {
+            flags |= FLAG_QUIET_DMA;
+        } else if ((value = arg_value(argv[arg], "RANGE=")) != NULL) {
+            if (range_parse(value) != 0) {
+                usage();
+                return (1);
+            }
+            flag_range = 1;
+        } else if (stricmp(argv[arg], "RECAL") == 0) {
+            calib_recal = 1;
+        } else if ((value = arg_value(argv[arg], "RESULTS=")) != NULL) {
+            results_file = value;
+        } else if ((value = arg_value(argv[arg], "RETEST=")) != NULL) {
+            retest_file = value;
         } else if (stricmp(argv[arg], "SPROBE") == 0) {
             flag_sprobe = 1;
         } else if (stricmp(argv[arg], "STROBE") == 0) {
             flag_strobe = 1;
+        } else if ((value = arg_value(argv[arg], "STROBE=")) != NULL) {
+            strobe_file = value;
+        } else if ((value = arg_value(argv[arg], "TIME=")) != NULL) {
+            loop_secs = strtoul(value, NULL, 0);
+            if (loop_secs == 0) {
+                usage();
+                return (1);
+            }
+        } else if (stricmp(argv[arg], "TIMING") == 0) {
+            timing_enabled = 1;
+        } else if ((value = arg_value(argv[arg], "TRACE=")) != NULL) {
+            trace_file = value;
+        } else if (stricmp(argv[arg], "TRIGGER") == 0) {
+            flags |= FLAG_TRIGGER;
+        } else if (stricmp(argv[arg], "TUNE") == 0) {
+            flag_tune = 1;
+        } else if ((value = arg_value(argv[arg], "WATCH=")) != NULL) {
+            watch_name = value;
         } else {
             usage();
             return (1);
         }
     }
+    if ((flags & FLAG_TRIGGER) && markers_enabled) {
+        printf("MARKERS and TRIGGER both use the parallel port data lines\n");
+        return (1);
+    }
     if (!flag_quiet)
         printf("%s\n", version + 7);
 
+    /* Open before calibration, which may mark Static Column read timing */
+    if (markers_enabled)
+        markers_open();
+    if ((trace_file != NULL) && (trace_open() != 0)) {
+        rc = 1;
+        goto done;
+    }
+
+    etimer_init();
     cpu_type = get_cpu();
+    cpu_ops_init();
     mmu_open();
     if (!flag_quiet) {
-        cpu_can_do_burst = cpu_can_burst();
-        printf("CPU: %u %s Burst%s\n", cpu_type,
+        uint gain;
+
+        cpu_can_do_burst = cpu_can_burst_cached();
+        gain = (cpu_burst_calib.estimate > 1000) ?
+               cpu_burst_calib.estimate - 1000 : 0;
+        printf("CPU: %u %s Burst (+%u.%u%% +/-%u.%u%%)%s\n", cpu_type,
                cpu_can_do_burst ? "with" : "without",
+               gain / 10, gain % 10,
+               cpu_burst_calib.error / 10, cpu_burst_calib.error % 10,
                mmu_is_active ? ", MMU Active" : "");
     }
 
-    if (!flag_force && enforcer_check())
-        return (1);
-    if (ramsey_check() && !flag_force)
-        return (1);
+    if (!flag_force && enforcer_check()) {
+        rc = 1;
+        goto done;
+    }
+    if (ramsey_check() && !flag_force) {
+        rc = 1;
+        goto done;
+    }
 
     /* Use bitwise OR here so that all sections are checked and reported */
     if (section_verify("sp", &rc) |
         section_verify("pc", (void *) c_main) |
         section_verify("rodata", dip_u_data)) {
-        return (1);
+        rc = 1;
+        goto done;
     }
 
     ramsey_version = get_ramsey_version();
@@ -2359,12 +6821,17 @@ c_main(int argc, char **argv)
         mem_width = 4;  // x1 RAM support removed, cycle skip mode added
     }
     bank_size  = BIT(mem_addrbits) * mem_width;
+    timing_bank_size = bank_size;
 
     if (flag_info || !flag_quiet) {
-        ramsey_khz = get_ramsey_clock() + 5;  // round up
-        printf("Memory controller: Ramsey-0%d $%x $%02x (%u.%02u MHz)\n",
+        ramsey_khz = get_ramsey_clock_cached(&ramsey_khz_err);
+        ramsey_khz += 5;  // round up
+        ramsey_khz_err += 5;
+        printf("Memory controller: Ramsey-0%d $%x $%02x "
+               "(%u.%02u +/-%u.%02u MHz)\n",
                 ramsey_rev, ramsey_version, get_ramsey_control(),
-                ramsey_khz / 1000, (ramsey_khz % 1000) / 10);
+                ramsey_khz / 1000, (ramsey_khz % 1000) / 10,
+                ramsey_khz_err / 1000, (ramsey_khz_err % 1000) / 10);
         printf("Memory config: %sx%u (%u%cB per bank)",
                (mem_addrbits == 20) ? "1M" : "256", mem_width,
                (bank_size >> 20) ? (bank_size >> 20) : (bank_size >> 10),
@@ -2401,52 +6868,209 @@ c_main(int argc, char **argv)
     }
 
     if (!flag_addr_test && !flag_data_test && !flag_cell_test &&
-        !flag_strobe && !flag_sprobe) {
+        !flag_strobe && !flag_sprobe && !flag_burst && !flag_ileave &&
+        !flag_tune && !flag_range) {
         flag_addr_test = 1;
         flag_data_test = 1;
         flag_cell_test = 1;
     }
-    if (flag_info) {
-        return (0);
+    if (flag_info)
+        goto done;
+    if (retest_file != NULL) {
+        /* Also run the optional tests which failed last time */
+        if (results_load(retest_file) != 0) {
+            rc = 1;
+            goto done;
+        }
+        if (results_file == NULL)
+            results_file = retest_file;
+        if (retest.phase_errs[PHASE_BURST] != 0)
+            flag_burst = 1;
+        if (retest.phase_errs[PHASE_ILEAVE] != 0)
+            flag_ileave = 1;
+        if ((retest.phase_errs[PHASE_RANGE] != 0) && (test_range_count == 0))
+            printf("Specify RANGE= to retest failures in address ranges\n");
     }
+    if (flag_history)
+        history_load();
 
 #ifdef TEST_BANK_AMASK_TO_ADDRESS
     selftest_bank_amask_to_address();
-    return (0);
+    goto done;
 #endif
     if (flag_strobe) {
         gen_address_strobes(mem_addrbits, flags);
-        return (0);
+        goto done;
+    }
+    if (strobe_file != NULL) {
+        rc = strobe_script(strobe_file, mem_addrbits, flags);
+        goto done;
     }
 
     if (flags & FLAG_SHOW_MAP) {
         (void) data_line_test(mem_addrbits, flags);
         address_line_map(mem_addrbits);
-        return (0);
+        goto done;
     }
 
-    if (flag_data_test) {
-        printf("\n");
-        rc = data_line_test(mem_addrbits, flags);
+    if (watch_name != NULL) {
+        rc = watch_socket(watch_name, mem_addrbits, flags);
+        goto done;
+    }
+
+    if (bench_reps != 0) {
+        rc = bench_matrix(bank_size, bench_reps, flags);
+        goto done;
+    }
+    if (flag_latency) {
+        latency_test(mem_addrbits, flags);
+        goto done;
     }
 
-    if (flag_addr_test) {
+    if ((flags & FLAG_QUIET_DMA) &&
+        (flag_cell_test || flag_burst || flag_ileave || flag_range)) {
         printf("\n");
-        rc2 = address_line_test(mem_addrbits, flags);
-        if (rc == 0)
-            rc = rc2;
+        dma_quiet_report();
     }
 
-    if (flag_sprobe) {
+    if (flags & FLAG_TRIGGER)
+        trigger_open();
+
+    /*
+     * With LOOP= or TIME=, the selected tests are repeated without the
+     * startup cost of probing and calibration.  Per-test output is
+     * replaced by a single summary line per iteration.
+     */
+    looping = (loop_count != 0) || (loop_secs != 0);
+    tflags  = flags;
+    if (looping) {
+        tflags = (flags | FLAG_SUMMARY) & ~FLAG_SHOW_DIP;
         printf("\n");
-        sc_memory_probe(mem_addrbits, flags);
+    }
+    DateStamp(&loop_start);
+    for (loop = 1; ; loop++) {
+        int errs = 0;
+
+        memset(socket_fails, 0, sizeof (socket_fails));
+
+        if (flag_data_test) {
+            if (!looping)
+                printf("\n");
+            timing_begin(PHASE_DATA);
+            rc2 = data_line_test(mem_addrbits,
+                                 retest_flags(PHASE_DATA, tflags));
+            timing_end();
+            results_update(PHASE_DATA, rc2);
+            errs += rc2;
+            if (rc == 0)
+                rc = rc2;
+        }
+
+        if (flag_addr_test && !(errs && (flags & FLAG_FAIL_FAST))) {
+            if (!looping)
+                printf("\n");
+            timing_begin(PHASE_ADDR);
+            rc2 = address_line_test(mem_addrbits,
+                                    retest_flags(PHASE_ADDR, tflags));
+            timing_end();
+            results_update(PHASE_ADDR, rc2);
+            errs += rc2;
+            if (rc == 0)
+                rc = rc2;
+        }
+
+        if (flag_sprobe && (loop == 1) &&
+            !(errs && (flags & FLAG_FAIL_FAST))) {
+            printf("\n");
+            sc_memory_probe(mem_addrbits, flags);
+        }
+
+        if (flag_cell_test && !(errs && (flags & FLAG_FAIL_FAST))) {
+            if (!looping)
+                printf("\n");
+            timing_begin(PHASE_CELL);
+            rc2 = cell_data_test(bank_size, retest_flags(PHASE_CELL, tflags));
+            timing_end();
+            results_update(PHASE_CELL, rc2);
+            errs += rc2;
+            if (rc == 0)
+                rc = rc2;
+        }
+
+        if (flag_burst && !(errs && (flags & FLAG_FAIL_FAST))) {
+            if (!looping)
+                printf("\n");
+            timing_begin(PHASE_BURST);
+            rc2 = cell_burst_test(bank_size,
+                                  retest_flags(PHASE_BURST, tflags));
+            timing_end();
+            results_update(PHASE_BURST, rc2);
+            errs += rc2;
+            if (rc == 0)
+                rc = rc2;
+        }
+
+        if (flag_ileave && !(errs && (flags & FLAG_FAIL_FAST))) {
+            if (!looping)
+                printf("\n");
+            timing_begin(PHASE_ILEAVE);
+            rc2 = interleave_test(bank_size,
+                                  retest_flags(PHASE_ILEAVE, tflags));
+            timing_end();
+            results_update(PHASE_ILEAVE, rc2);
+            errs += rc2;
+            if (rc == 0)
+                rc = rc2;
+        }
+
+        if (flag_range && !(errs && (flags & FLAG_FAIL_FAST))) {
+            if (!looping)
+                printf("\n");
+            timing_begin(PHASE_RANGE);
+            rc2 = range_test(bank_size, retest_flags(PHASE_RANGE, tflags));
+            timing_end();
+            results_update(PHASE_RANGE, rc2);
+            errs += rc2;
+            if (rc == 0)
+                rc = rc2;
+        }
+
+        if (!looping)
+            break;
+        socket_stats_update(loop, elapsed_seconds(&loop_start), errs);
+        if (((loop_count != 0) && (loop >= loop_count)) ||
+            (errs && (flags & FLAG_FAIL_FAST)) ||
+            ((loop_secs != 0) &&
+             (elapsed_seconds(&loop_start) >= loop_secs))) {
+            break;
+        }
+        if (SetSignal(0, 0) & SIGBREAKF_CTRL_C) {
+            SetSignal(0, SIGBREAKF_CTRL_C);
+            printf("^C\n");
+            break;
+        }
+    }
+    if (flags & FLAG_TRIGGER)
+        trigger_close();
+    if (looping)
+        socket_stats_show(loop);
+    if (timing_enabled)
+        timing_report();
+    if (flag_history)
+        history_save();
+    if ((results_file != NULL) && (results_save(results_file) != 0) &&
+        (rc == 0)) {
+        rc = 1;
     }
 
-    if (flag_cell_test) {
+    if (flag_tune) {
         printf("\n");
-        rc2 = cell_data_test(bank_size, flags);
-        if (rc == 0)
-            rc = rc2;
+        ramsey_tune(bank_size, flags);
     }
+
+done:
+    trace_close();
+    if (markers_enabled)
+        markers_close();
     return (rc);
 }